@@ -0,0 +1,746 @@
+#include "toy/AOT.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+using namespace toy;
+
+namespace {
+
+// Tensors up to this many bytes are stored inline; must match InlineBytes in
+// the prelude.
+constexpr size_t InlineBytes = 64 * 1024;
+
+// Support code copied into every generated source file. Shapes are template
+// parameters, so every loop below has constant bounds after specialization.
+const char *Prelude = R"(#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace {
+
+// Small tensors are plain arrays, so temporaries live in registers or on the
+// stack. Larger ones own heap storage: a chain of <1000,1000> temporaries
+// would otherwise overflow the stack.
+constexpr size_t InlineBytes = 64 * 1024;
+
+template <typename T, size_t N, bool Inline = N * sizeof(T) <= InlineBytes>
+struct storage {
+    static constexpr bool isInline = true;
+    static constexpr size_t size = N;
+    T data[N];
+};
+
+template <typename T, size_t N>
+struct storage<T, N, false> {
+    static constexpr bool isInline = false;
+    static constexpr size_t size = N;
+    storage() : data(new T[N]) {}
+    storage(const storage &other) : storage() { std::memcpy(data, other.data, sizeof(T) * N); }
+    storage(storage &&other) noexcept : data(other.data) { other.data = nullptr; }
+    storage &operator=(const storage &) = delete;
+    ~storage() { delete[] data; }
+    T *data;
+};
+
+template <typename T, size_t R, size_t C>
+struct tensor : storage<T, R * C> {};
+
+// A tensor backed by a flat array, such as a C ABI argument: inline tensors
+// are read in place, larger ones are copied into owned storage.
+template <typename Tensor, typename T>
+decltype(auto) fromArray(const T *p) {
+    if constexpr (Tensor::isInline) {
+        return *reinterpret_cast<const Tensor *>(p);
+    } else {
+        Tensor r;
+        std::memcpy(r.data, p, sizeof(*p) * Tensor::size);
+        return r;
+    }
+}
+
+template <char Op, typename T>
+inline T apply(T a, T b) {
+    if constexpr (Op == '+') {
+        return a + b;
+    } else if constexpr (Op == '-') {
+        return a - b;
+    } else if constexpr (Op == '*') {
+        return a * b;
+    } else {
+        return a / b;
+    }
+}
+
+template <char Op, typename T, size_t R, size_t C>
+tensor<T, R, C> binop(const tensor<T, R, C> &a, const tensor<T, R, C> &b) {
+    tensor<T, R, C> r;
+    for (size_t i = 0; i < R * C; i++) {
+        r.data[i] = apply<Op>(a.data[i], b.data[i]);
+    }
+    return r;
+}
+
+template <char Op, bool ScalarIsLHS, typename T, size_t R, size_t C>
+tensor<T, R, C> binopScalar(const tensor<T, R, C> &a, T s) {
+    tensor<T, R, C> r;
+    for (size_t i = 0; i < R * C; i++) {
+        r.data[i] = ScalarIsLHS ? apply<Op>(s, a.data[i]) : apply<Op>(a.data[i], s);
+    }
+    return r;
+}
+
+template <size_t R2, size_t C2, typename T, size_t R, size_t C>
+tensor<T, R2, C2> reshape(const tensor<T, R, C> &a) {
+    static_assert(R * C == R2 * C2, "reshape must preserve the element count");
+    tensor<T, R2, C2> r;
+    std::memcpy(r.data, a.data, sizeof(T) * R * C);
+    return r;
+}
+
+template <typename U, typename T, size_t R, size_t C>
+tensor<U, R, C> convert(const tensor<T, R, C> &a) {
+    tensor<U, R, C> r;
+    for (size_t i = 0; i < R * C; i++) {
+        r.data[i] = static_cast<U>(a.data[i]);
+    }
+    return r;
+}
+
+template <typename T, size_t R, size_t C>
+tensor<T, C, R> transpose(const tensor<T, R, C> &a) {
+    tensor<T, C, R> r;
+    for (size_t i = 0; i < R; i++) {
+        for (size_t j = 0; j < C; j++) {
+            r.data[j * R + i] = a.data[i * C + j];
+        }
+    }
+    return r;
+}
+
+template <typename T, size_t M, size_t K, size_t N>
+tensor<T, M, N> matmul(const tensor<T, M, K> &a, const tensor<T, K, N> &b) {
+    tensor<T, M, N> r;
+    std::fill(r.data, r.data + M * N, T(0));
+    for (size_t i = 0; i < M; i++) {
+        for (size_t p = 0; p < K; p++) {
+            T x = a.data[i * K + p];
+            for (size_t j = 0; j < N; j++) {
+                r.data[i * N + j] += x * b.data[p * N + j];
+            }
+        }
+    }
+    return r;
+}
+
+// Kind is 's' (sum), 'm' (mean) or 'x' (max).
+template <char Kind, typename T>
+inline T reduceInit() {
+    return Kind == 'x' ? -std::numeric_limits<T>::infinity() : T(0);
+}
+
+template <char Kind, typename T>
+inline T reduceStep(T acc, T x) {
+    return Kind == 'x' ? (x > acc || x != x ? x : acc) : acc + x;
+}
+
+template <char Kind, typename T>
+inline T reduceFinish(T acc, size_t count) {
+    return Kind == 'm' ? acc / T(count) : acc;
+}
+
+template <char Kind, typename T, size_t R, size_t C>
+tensor<T, 1, 1> reduceAll(const tensor<T, R, C> &a) {
+    T acc = reduceInit<Kind, T>();
+    for (size_t i = 0; i < R * C; i++) {
+        acc = reduceStep<Kind>(acc, a.data[i]);
+    }
+    return {{reduceFinish<Kind>(acc, R * C)}};
+}
+
+template <char Kind, typename T, size_t R, size_t C>
+tensor<T, 1, C> reduceAxis0(const tensor<T, R, C> &a) {
+    tensor<T, 1, C> r;
+    for (size_t j = 0; j < C; j++) {
+        r.data[j] = reduceInit<Kind, T>();
+    }
+    for (size_t i = 0; i < R; i++) {
+        for (size_t j = 0; j < C; j++) {
+            r.data[j] = reduceStep<Kind>(r.data[j], a.data[i * C + j]);
+        }
+    }
+    for (size_t j = 0; j < C; j++) {
+        r.data[j] = reduceFinish<Kind>(r.data[j], R);
+    }
+    return r;
+}
+
+template <char Kind, typename T, size_t R, size_t C>
+tensor<T, R, 1> reduceAxis1(const tensor<T, R, C> &a) {
+    tensor<T, R, 1> r;
+    for (size_t i = 0; i < R; i++) {
+        T acc = reduceInit<Kind, T>();
+        for (size_t j = 0; j < C; j++) {
+            acc = reduceStep<Kind>(acc, a.data[i * C + j]);
+        }
+        r.data[i] = reduceFinish<Kind>(acc, C);
+    }
+    return r;
+}
+
+template <typename T, size_t R, size_t C>
+void print(const tensor<T, R, C> &a) {
+    std::string buf(R * C * 32, '\0');
+    char *out = &buf[0];
+    for (size_t i = 0; i < R * C; i++) {
+        out = std::to_chars(out, out + 32, a.data[i]).ptr;
+        *out++ = (i + 1) % C ? ' ' : '\n';
+    }
+    std::fwrite(buf.data(), 1, out - buf.data(), stdout);
+}
+
+} // namespace
+)";
+
+struct StaticType {
+    size_t rows;
+    size_t cols;
+    ElementType type;
+
+    bool operator==(const StaticType &other) const {
+        return rows == other.rows && cols == other.cols && type == other.type;
+    }
+};
+
+std::string cType(ElementType type) {
+    return type == ElementType::F32 ? "float" : "double";
+}
+
+std::string cppType(const StaticType &t) {
+    return "tensor<" + cType(t.type) + ", " + std::to_string(t.rows) + ", " + std::to_string(t.cols) + ">";
+}
+
+std::string describe(const StaticType &t) {
+    return "<" + std::to_string(t.rows) + "," + std::to_string(t.cols) + "> " + elementTypeName(t.type);
+}
+
+std::string formatNumber(double v) {
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    return std::string(buf, res.ptr);
+}
+
+bool flatten(ExprAST *expr, std::vector<double> &values) {
+    // Literals nest as deeply as the parser accepts; walk them without recursion.
+    std::vector<ExprAST *> worklist = {expr};
+    while (!worklist.empty()) {
+        ExprAST *next = worklist.back();
+        worklist.pop_back();
+        if (auto num = dyn_cast<NumberExprAST>(next)) {
+            values.push_back(num->getVal());
+            continue;
+        }
+        auto lit = dyn_cast<LiteralExprAST>(next);
+        if (!lit) {
+            return false;
+        }
+        auto &children = lit->getValues();
+        for (size_t i = children.size(); i-- > 0;) {
+            worklist.push_back(children[i].get());
+        }
+    }
+    return true;
+}
+
+// A generated C++ expression. `name` is empty for calls that produce no value.
+struct Value {
+    std::string name;
+    StaticType type;
+};
+
+struct Specialization {
+    std::string symbol;
+    FunctionExprAST *func;
+    std::vector<StaticType> args;
+    std::optional<StaticType> result;
+    std::string body;
+    bool done = false;
+};
+
+class AOTEmitter {
+public:
+    AOTEmitter(ModuleAST &module, ElementType defaultType, std::ostream &errs) : defaultType(defaultType), errs(errs) {
+        for (auto &func : module.getFunctions()) {
+            functions[func->getProto()->getName()] = func.get();
+        }
+    }
+
+    bool emit(const std::string &sourceName, std::ostream &source, std::ostream &header, const std::string &headerName);
+
+private:
+    struct Frame {
+        std::unordered_map<std::string, Value> vars;
+        std::ostringstream body;
+        int temps = 0;
+    };
+
+    Specialization *specialize(FunctionExprAST *func, const std::vector<StaticType> &args, const Location &loc);
+    std::optional<Value> emit(ExprAST *expr, Frame &frame);
+    std::optional<Value> emitKind(ExprAST *expr, Frame &frame);
+    std::optional<Value> emit(VarDeclExprAST *expr, Frame &frame);
+    std::optional<Value> emit(BinOpExprAST *expr, Frame &frame);
+    std::optional<Value> emit(CallExprAST *expr, Frame &frame);
+    std::optional<Value> emit(LiteralExprAST *expr, Frame &frame);
+    std::optional<Value> emitBuiltin(CallExprAST *expr, Frame &frame);
+    std::optional<Value> emitOperand(ExprAST *expr, Frame &frame);
+
+    Value define(Frame &frame, const StaticType &type, const std::string &init);
+    static std::string convert(const Value &value, ElementType type);
+    std::optional<Value> error(const Location &loc, const std::string &msg);
+
+    ElementType defaultType;
+    std::ostream &errs;
+    std::unordered_map<std::string, FunctionExprAST *> functions;
+    std::unordered_map<std::string, std::unique_ptr<Specialization>> specs;
+    // Specializations in completion order, so callees precede their callers.
+    std::vector<Specialization *> emitted;
+    // Expressions being emitted, counted across specializations. Deeper
+    // nesting is reported instead of overflowing the stack.
+    static constexpr int MaxExprDepth = 2000;
+    int exprDepth = 0;
+};
+
+std::optional<Value> AOTEmitter::error(const Location &loc, const std::string &msg) {
+    errs << "Error: " << msg << " at line " << loc.Line << " column " << loc.Column << std::endl;
+    return std::nullopt;
+}
+
+Value AOTEmitter::define(Frame &frame, const StaticType &type, const std::string &init) {
+    Value value{"t" + std::to_string(frame.temps++), type};
+    frame.body << "    const " << cppType(type) << " " << value.name << " = " << init << ";\n";
+    return value;
+}
+
+std::string AOTEmitter::convert(const Value &value, ElementType type) {
+    if (value.type.type == type) {
+        return value.name;
+    }
+    return "convert<" + cType(type) + ">(" + value.name + ")";
+}
+
+Specialization *AOTEmitter::specialize(FunctionExprAST *func, const std::vector<StaticType> &args,
+                                       const Location &loc) {
+    auto &proto = func->getProto();
+    std::string symbol = proto->getName();
+    for (auto &arg : args) {
+        symbol += "_" + std::to_string(arg.rows) + "x" + std::to_string(arg.cols) + elementTypeName(arg.type);
+    }
+    auto it = specs.find(symbol);
+    if (it != specs.end()) {
+        if (it->second->func != func || it->second->args != args) {
+            error(loc, "specializations of '" + proto->getName() + "' clash on symbol '" + symbol + "'");
+            return nullptr;
+        }
+        if (!it->second->done) {
+            error(loc, "recursive call to '" + proto->getName() + "' cannot be specialized");
+            return nullptr;
+        }
+        return it->second.get();
+    }
+    if (proto->getArgs().size() != args.size()) {
+        error(loc, "'" + proto->getName() + "' expects " + std::to_string(proto->getArgs().size()) +
+                       " arguments but got " + std::to_string(args.size()));
+        return nullptr;
+    }
+
+    auto owned = std::make_unique<Specialization>();
+    Specialization *spec = owned.get();
+    spec->symbol = symbol;
+    spec->func = func;
+    spec->args = args;
+    specs[symbol] = std::move(owned);
+
+    Frame frame;
+    for (size_t i = 0; i < args.size(); i++) {
+        frame.vars[proto->getArgs()[i]->getName()] = {"p_" + proto->getArgs()[i]->getName(), args[i]};
+    }
+    for (auto &expr : func->getBlock()->getExprs()) {
+        if (auto ret = dyn_cast<ReturnExprAST>(expr.get())) {
+            auto value = emitOperand(ret->getValue().get(), frame);
+            if (!value) {
+                return nullptr;
+            }
+            frame.body << "    return " << value->name << ";\n";
+            spec->result = value->type;
+            break;
+        }
+        if (!emit(expr.get(), frame)) {
+            return nullptr;
+        }
+    }
+    spec->body = frame.body.str();
+    spec->done = true;
+    emitted.push_back(spec);
+    return spec;
+}
+
+std::optional<Value> AOTEmitter::emitOperand(ExprAST *expr, Frame &frame) {
+    auto value = emit(expr, frame);
+    if (value && value->name.empty()) {
+        return error(expr->loc(), "expression has no value");
+    }
+    return value;
+}
+
+std::optional<Value> AOTEmitter::emit(ExprAST *expr, Frame &frame) {
+    if (exprDepth >= MaxExprDepth) {
+        return error(expr->loc(), "expression nesting exceeds " + std::to_string(MaxExprDepth));
+    }
+    exprDepth++;
+    auto value = emitKind(expr, frame);
+    exprDepth--;
+    return value;
+}
+
+std::optional<Value> AOTEmitter::emitKind(ExprAST *expr, Frame &frame) {
+    switch (expr->getKind()) {
+        case ExprAST::Expr_Var: {
+            auto var = static_cast<VariableExprAST *>(expr);
+            auto it = frame.vars.find(var->getName());
+            if (it == frame.vars.end()) {
+                return error(expr->loc(), "unknown variable '" + var->getName() + "'");
+            }
+            return it->second;
+        }
+        case ExprAST::Expr_VarDecl:
+            return emit(static_cast<VarDeclExprAST *>(expr), frame);
+        case ExprAST::Expr_BinOp:
+            return emit(static_cast<BinOpExprAST *>(expr), frame);
+        case ExprAST::Expr_Call:
+            return emit(static_cast<CallExprAST *>(expr), frame);
+        case ExprAST::Expr_Literal:
+            return emit(static_cast<LiteralExprAST *>(expr), frame);
+        case ExprAST::Expr_Num: {
+            StaticType type{1, 1, defaultType};
+            return define(frame, type,
+                          "{{" + cType(defaultType) + "(" + formatNumber(static_cast<NumberExprAST *>(expr)->getVal()) + ")}}");
+        }
+        case ExprAST::Expr_String:
+            return error(expr->loc(), "string is only valid as a builtin argument");
+        default:
+            return error(expr->loc(), "unexpected expression");
+    }
+}
+
+std::optional<Value> AOTEmitter::emit(VarDeclExprAST *expr, Frame &frame) {
+    if (frame.vars.count(expr->getName())) {
+        return error(expr->loc(), "redefinition of '" + expr->getName() + "'");
+    }
+    auto value = emitOperand(expr->getExpr().get(), frame);
+    if (!value) {
+        return std::nullopt;
+    }
+    std::string init = value->name;
+    StaticType type = value->type;
+    auto &shape = expr->getType().shape;
+    if (!shape.empty()) {
+        if (shape[0] <= 0 || shape[1] <= 0 || size_t(shape[0]) * size_t(shape[1]) != type.rows * type.cols) {
+            return error(expr->loc(), "cannot reshape " + describe(type) + " to <" + std::to_string(shape[0]) + "," +
+                                          std::to_string(shape[1]) + ">");
+        }
+        if (size_t(shape[0]) != type.rows) {
+            type.rows = shape[0];
+            type.cols = shape[1];
+            init = "reshape<" + std::to_string(type.rows) + ", " + std::to_string(type.cols) + ">(" + init + ")";
+        }
+    }
+    if (expr->getType().elementType && *expr->getType().elementType != type.type) {
+        type.type = *expr->getType().elementType;
+        init = "convert<" + cType(type.type) + ">(" + init + ")";
+    }
+    Value var{"v_" + expr->getName(), type};
+    frame.body << "    const " << cppType(type) << " &" << var.name << " = " << init << ";\n";
+    frame.vars[expr->getName()] = var;
+    return var;
+}
+
+std::optional<Value> AOTEmitter::emit(BinOpExprAST *expr, Frame &frame) {
+    char op = expr->getOp();
+    if (op != '+' && op != '-' && op != '*' && op != '/') {
+        return error(expr->loc(), std::string("unsupported operator '") + op + "'");
+    }
+    std::string opArg = std::string("'") + op + "'";
+
+    // Same rules as the interpreter: a number literal next to a tensor is a
+    // weakly typed scalar, any other <1,1> operand broadcasts after promotion.
+    auto lhsNum = dyn_cast<NumberExprAST>(expr->getLHS().get());
+    auto rhsNum = dyn_cast<NumberExprAST>(expr->getRHS().get());
+    if ((lhsNum == nullptr) != (rhsNum == nullptr)) {
+        bool scalarIsLHS = lhsNum != nullptr;
+        auto tensor = emitOperand(scalarIsLHS ? expr->getRHS().get() : expr->getLHS().get(), frame);
+        if (!tensor) {
+            return std::nullopt;
+        }
+        double scalar = (scalarIsLHS ? lhsNum : rhsNum)->getVal();
+        return define(frame, tensor->type,
+                      "binopScalar<" + opArg + ", " + (scalarIsLHS ? "true" : "false") + ">(" + tensor->name + ", " +
+                          cType(tensor->type.type) + "(" + formatNumber(scalar) + "))");
+    }
+
+    auto lhs = emitOperand(expr->getLHS().get(), frame);
+    if (!lhs) {
+        return std::nullopt;
+    }
+    auto rhs = emitOperand(expr->getRHS().get(), frame);
+    if (!rhs) {
+        return std::nullopt;
+    }
+    ElementType type = promote(lhs->type.type, rhs->type.type);
+    if (lhs->type.rows == rhs->type.rows && lhs->type.cols == rhs->type.cols) {
+        return define(frame, {lhs->type.rows, lhs->type.cols, type},
+                      "binop<" + opArg + ">(" + convert(*lhs, type) + ", " + convert(*rhs, type) + ")");
+    }
+    for (bool scalarIsLHS : {true, false}) {
+        const Value &scalar = scalarIsLHS ? *lhs : *rhs;
+        const Value &tensor = scalarIsLHS ? *rhs : *lhs;
+        if (scalar.type.rows == 1 && scalar.type.cols == 1) {
+            return define(frame, {tensor.type.rows, tensor.type.cols, type},
+                          "binopScalar<" + opArg + ", " + (scalarIsLHS ? "true" : "false") + ">(" +
+                              convert(tensor, type) + ", " + cType(type) + "(" + scalar.name + ".data[0]))");
+        }
+    }
+    return error(expr->loc(), "shape mismatch " + describe(lhs->type) + " " + op + " " + describe(rhs->type));
+}
+
+std::optional<Value> AOTEmitter::emit(CallExprAST *expr, Frame &frame) {
+    auto it = functions.find(expr->getCallee());
+    if (it == functions.end()) {
+        return emitBuiltin(expr, frame);
+    }
+    std::vector<Value> args;
+    std::vector<StaticType> types;
+    for (auto &arg : expr->getArgs()) {
+        auto value = emitOperand(arg.get(), frame);
+        if (!value) {
+            return std::nullopt;
+        }
+        args.push_back(*value);
+        types.push_back(value->type);
+    }
+    Specialization *spec = specialize(it->second, types, expr->loc());
+    if (!spec) {
+        return std::nullopt;
+    }
+    std::string call = "fn_" + spec->symbol + "(";
+    for (size_t i = 0; i < args.size(); i++) {
+        call += (i ? ", " : "") + args[i].name;
+    }
+    call += ")";
+    if (!spec->result) {
+        frame.body << "    " << call << ";\n";
+        return Value{"", {}};
+    }
+    return define(frame, *spec->result, call);
+}
+
+std::optional<Value> AOTEmitter::emit(LiteralExprAST *expr, Frame &frame) {
+    std::vector<double> values;
+    if (!flatten(expr, values)) {
+        return error(expr->loc(), "tensor literal may only contain numbers");
+    }
+    auto &shape = expr->getType().shape;
+    if (values.empty() || shape[0] <= 0 || shape[1] <= 0 || size_t(shape[0]) * size_t(shape[1]) != values.size()) {
+        return error(expr->loc(), "only non-empty tensor literals of rank <= 2 can be compiled");
+    }
+    StaticType type{size_t(shape[0]), size_t(shape[1]), defaultType};
+    Value value{"t" + std::to_string(frame.temps++), type};
+    bool isInline = values.size() * elementSize(type.type) <= InlineBytes;
+    frame.body << "    static constexpr " << (isInline ? cppType(type) + " " + value.name + " = {{"
+                                                         : cType(type.type) + " " + value.name + "_values[] = {");
+    for (size_t i = 0; i < values.size(); i++) {
+        frame.body << (i ? ", " : "") << formatNumber(values[i]);
+    }
+    if (isInline) {
+        frame.body << "}};\n";
+    } else {
+        frame.body << "};\n    static const " << cppType(type) << " " << value.name << " = fromArray<"
+                   << cppType(type) << ">(" << value.name << "_values);\n";
+    }
+    return value;
+}
+
+std::optional<Value> AOTEmitter::emitBuiltin(CallExprAST *expr, Frame &frame) {
+    const std::string &callee = expr->getCallee();
+    auto &args = expr->getArgs();
+
+    if (callee == "load" || callee == "store") {
+        return error(expr->loc(), "'" + callee + "' is not supported ahead of time; pass tensors through the C ABI");
+    }
+
+    if (callee == "sum" || callee == "mean" || callee == "max") {
+        auto axis = args.size() == 2 ? dyn_cast<NumberExprAST>(args[1].get()) : nullptr;
+        if ((args.size() != 1 && args.size() != 2) || (args.size() == 2 && !axis) ||
+            (axis && axis->getVal() != 0 && axis->getVal() != 1)) {
+            return error(expr->loc(), "expected " + callee + "(value) or " + callee + "(value, 0|1)");
+        }
+        auto value = emitOperand(args[0].get(), frame);
+        if (!value) {
+            return std::nullopt;
+        }
+        std::string kind = callee == "sum" ? "'s'" : callee == "mean" ? "'m'" : "'x'";
+        StaticType type = value->type;
+        std::string fn = "reduceAll";
+        if (!axis) {
+            type.rows = type.cols = 1;
+        } else if (axis->getVal() == 0) {
+            type.rows = 1;
+            fn = "reduceAxis0";
+        } else {
+            type.cols = 1;
+            fn = "reduceAxis1";
+        }
+        return define(frame, type, fn + "<" + kind + ">(" + value->name + ")");
+    }
+
+    if (callee == "matmul") {
+        if (args.size() != 2) {
+            return error(expr->loc(), "'matmul' expects 2 arguments");
+        }
+        auto lhs = emitOperand(args[0].get(), frame);
+        if (!lhs) {
+            return std::nullopt;
+        }
+        auto rhs = emitOperand(args[1].get(), frame);
+        if (!rhs) {
+            return std::nullopt;
+        }
+        if (lhs->type.cols != rhs->type.rows) {
+            return error(expr->loc(), "shape mismatch in matmul(" + describe(lhs->type) + ", " + describe(rhs->type) + ")");
+        }
+        ElementType type = promote(lhs->type.type, rhs->type.type);
+        return define(frame, {lhs->type.rows, rhs->type.cols, type},
+                      "matmul(" + convert(*lhs, type) + ", " + convert(*rhs, type) + ")");
+    }
+
+    if (callee != "transpose" && callee != "print") {
+        return error(expr->loc(), "unknown function '" + callee + "'");
+    }
+    if (args.size() != 1) {
+        return error(expr->loc(), "'" + callee + "' expects 1 argument");
+    }
+    auto value = emitOperand(args[0].get(), frame);
+    if (!value) {
+        return std::nullopt;
+    }
+    if (callee == "transpose") {
+        return define(frame, {value->type.cols, value->type.rows, value->type.type}, "transpose(" + value->name + ")");
+    }
+    frame.body << "    print(" << value->name << ");\n";
+    return Value{"", {}};
+}
+
+bool AOTEmitter::emit(const std::string &sourceName, std::ostream &source, std::ostream &header,
+                      const std::string &headerName) {
+    auto main = functions.find("main");
+    if (main == functions.end()) {
+        errs << "Error: no 'main' function" << std::endl;
+        return false;
+    }
+    if (!specialize(main->second, {}, main->second->getProto()->loc())) {
+        return false;
+    }
+
+    std::string guard;
+    for (char c : headerName) {
+        guard += std::isalnum(static_cast<unsigned char>(c)) ? std::toupper(static_cast<unsigned char>(c)) : '_';
+    }
+    header << "/* Generated by toy --aot from " << sourceName << ". Do not edit. */\n";
+    header << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+    header << "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n";
+
+    source << "// Generated by toy --aot from " << sourceName << ". Do not edit.\n";
+    source << "#include \"" << headerName << "\"\n\n" << Prelude << "\nnamespace {\n";
+
+    for (Specialization *spec : emitted) {
+        auto &params = spec->func->getProto()->getArgs();
+        source << "\n" << (spec->result ? cppType(*spec->result) : "void") << " fn_" << spec->symbol << "(";
+        for (size_t i = 0; i < params.size(); i++) {
+            source << (i ? ", " : "") << "const " << cppType(spec->args[i]) << " &p_" << params[i]->getName();
+        }
+        source << ") {\n" << spec->body << "}\n";
+    }
+    source << "\n} // namespace\n";
+
+    for (Specialization *spec : emitted) {
+        auto &params = spec->func->getProto()->getArgs();
+        bool isMain = spec->func == main->second;
+        std::string upper;
+        for (char c : spec->symbol) {
+            upper += std::toupper(static_cast<unsigned char>(c));
+        }
+
+        header << "/* " << spec->func->getProto()->getName() << "(";
+        for (size_t i = 0; i < params.size(); i++) {
+            header << (i ? ", " : "") << params[i]->getName() << ": " << describe(spec->args[i]);
+        }
+        header << ")";
+        if (spec->result) {
+            header << " -> " << describe(*spec->result);
+        }
+        header << " */\n";
+        if (spec->result && !isMain) {
+            header << "enum { TOY_" << upper << "_ROWS = " << spec->result->rows << ", TOY_" << upper
+                   << "_COLS = " << spec->result->cols << " };\n";
+        }
+
+        std::string signature = "void toy_" + spec->symbol + "(";
+        std::string call = "fn_" + spec->symbol + "(";
+        for (size_t i = 0; i < params.size(); i++) {
+            // Toy names may be C keywords or clash with `result`; they only
+            // appear in the comment above.
+            std::string arg = "arg" + std::to_string(i);
+            signature += (i ? ", " : "") + std::string("const ") + cType(spec->args[i].type) + " *" + arg;
+            call += (i ? ", " : "") + std::string("fromArray<") + cppType(spec->args[i]) + ">(" + arg + ")";
+        }
+        if (spec->result && !isMain) {
+            signature += (params.empty() ? "" : ", ") + cType(spec->result->type) + " *result";
+        } else if (params.empty()) {
+            signature += "void";
+        }
+        signature += ")";
+        call += ")";
+        header << signature << ";\n\n";
+
+        source << "\nextern \"C\" " << signature << " {\n";
+        if (spec->result && !isMain) {
+            source << "    const auto &value = " << call << ";\n";
+            source << "    std::memcpy(result, value.data, sizeof(value.data[0]) * value.size);\n";
+        } else {
+            source << "    " << call << ";\n";
+        }
+        source << "}\n";
+    }
+
+    header << "#ifdef __cplusplus\n}\n#endif\n\n#endif /* " << guard << " */\n";
+    return true;
+}
+
+} // namespace
+
+namespace toy {
+
+bool emitAOT(ModuleAST &module, const std::string &sourceName, ElementType defaultType, std::ostream &source,
+             std::ostream &header, const std::string &headerName, std::ostream &errs) {
+    return AOTEmitter(module, defaultType, errs).emit(sourceName, source, header, headerName);
+}
+
+} // namespace toy
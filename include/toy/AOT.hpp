@@ -0,0 +1,28 @@
+#ifndef AOT_HPP
+#define AOT_HPP
+#include <ostream>
+#include <string>
+#include "AST.hpp"
+#include "Types.hpp"
+
+namespace toy {
+
+// Ahead-of-time compile `module` to self-contained C++. Every function
+// reachable from `main` is specialized for the shapes and element types it
+// is called with, so all tensors become fixed-size arrays whose bounds the
+// host compiler can see. `source` receives the implementation and includes
+// `headerName`; `header` receives a C ABI with one entry point per
+// specialization:
+//
+//   void toy_<name>_<shapes>(const T *arg0, ..., T *result);
+//   void toy_main(void);
+//
+// Arguments and results are dense row-major arrays. Builtins that touch the
+// file system (load, store) are not supported. Returns false and reports to
+// `errs` if a shape cannot be determined statically.
+bool emitAOT(ModuleAST &module, const std::string &sourceName, ElementType defaultType, std::ostream &source,
+             std::ostream &header, const std::string &headerName, std::ostream &errs);
+
+};
+
+#endif // AOT_HPP
@@ -1,12 +1,16 @@
 #ifndef AST_HPP
 #define AST_HPP
+#include <optional>
 #include <vector>
 #include "Lexer.hpp"
+#include "Types.hpp"
 
 namespace toy {
 
 struct VarType {
     std::vector<int> shape;
+    // Set when the declaration names one, e.g. `var a<f32, 2, 3>`.
+    std::optional<ElementType> elementType;
 };
 
 class ExprAST {
@@ -15,12 +19,15 @@ public:
         Expr_VarDecl,
         Expr_Return,
         Expr_Num,
+        Expr_String,
         Expr_Literal,
         Expr_Var,
         Expr_BinOp,
         Expr_Call,
         Expr_Print,
         Expr_Prototype,
+        // Number of kinds; keep last.
+        Expr_KindCount,
     };
 
     ExprAST(Location Loc, ExprASTKind kind) : Loc(Loc), kind(kind) {}
@@ -33,6 +40,27 @@ public:
 
     ExprASTKind getKind() const { return kind; }
 
+protected:
+    using ChildList = std::vector<std::unique_ptr<ExprAST>>;
+
+    // Moves this node's children into `out`.
+    virtual void takeChildren(ChildList &) {}
+
+    // Called from the destructor of every node with children. Descendants
+    // are freed from a worklist instead of by nested unique_ptr destructors,
+    // which would recurse once per level of a long operator chain.
+    void destroyChildren() {
+        ChildList work;
+        takeChildren(work);
+        while (!work.empty()) {
+            auto node = std::move(work.back());
+            work.pop_back();
+            if (node) {
+                node->takeChildren(work);
+            }
+        }
+    }
+
 private:
     Location Loc;
     const ExprASTKind kind;
@@ -73,13 +101,19 @@ class VarDeclExprAST: public ExprAST {
 public:
     VarDeclExprAST(Location Loc, std::string Name, VarType Type, std::unique_ptr<ExprAST> Expr)
         : ExprAST(Loc, Expr_VarDecl), Name(Name), Type(Type), Expr(std::move(Expr)) {}
+
+    ~VarDeclExprAST() override { destroyChildren(); }
     
     static bool classof(const ExprAST *E) {
         return E->getKind() == Expr_VarDecl;
     }
 
     const std::string &getName() { return Name; }
+    VarType &getType() { return Type; }
     const std::unique_ptr<ExprAST> &getExpr() { return Expr; }
+
+protected:
+    void takeChildren(ChildList &out) override { out.push_back(std::move(Expr)); }
 };
 
 class ReturnExprAST: public ExprAST {
@@ -88,11 +122,16 @@ public:
     ReturnExprAST(Location Loc, std::unique_ptr<ExprAST> Value)
     : ExprAST(Loc, Expr_Return), Value(std::move(Value)) {}
 
+    ~ReturnExprAST() override { destroyChildren(); }
+
     static bool classof(const ExprAST *E) {
         return E->getKind() == Expr_Return;
     }
 
     std::unique_ptr<ExprAST> &getValue() { return Value; }
+
+protected:
+    void takeChildren(ChildList &out) override { out.push_back(std::move(Value)); }
 };
 
 class LiteralExprAST: public ExprAST {
@@ -102,12 +141,22 @@ public:
     LiteralExprAST(Location Loc, std::vector<std::unique_ptr<ExprAST>> &&Values, VarType Type)
         : ExprAST(Loc, Expr_Literal), Values(std::move(Values)), Type(Type) {}
 
+    ~LiteralExprAST() override { destroyChildren(); }
+
     static bool classof(const ExprAST *E) {
         return E->getKind() == Expr_Literal;
     }
     std::vector<std::unique_ptr<ExprAST>> &getValues() { return Values; }
 
     VarType &getType() { return Type; }
+
+protected:
+    void takeChildren(ChildList &out) override {
+        for (auto &value : Values) {
+            out.push_back(std::move(value));
+        }
+        Values.clear();
+    }
 };
 
 class NumberExprAST: public ExprAST {
@@ -122,6 +171,18 @@ public:
     double getVal() { return Val; }
 };
 
+class StringExprAST: public ExprAST {
+    std::string Val;
+public:
+    StringExprAST(Location Loc, std::string Val) : ExprAST(Loc, Expr_String), Val(Val) {}
+
+    static bool classof(const ExprAST *E) {
+        return E->getKind() == Expr_String;
+    }
+
+    const std::string &getVal() { return Val; }
+};
+
 class BinOpExprAST: public ExprAST {
     char Op;
     std::unique_ptr<ExprAST> LHS, RHS;
@@ -129,6 +190,8 @@ public:
     BinOpExprAST(Location Loc, char Op, std::unique_ptr<ExprAST> LHS, std::unique_ptr<ExprAST> RHS)
         : ExprAST(Loc, Expr_BinOp), Op(Op), LHS(std::move(LHS)), RHS(std::move(RHS)) {}
 
+    ~BinOpExprAST() override { destroyChildren(); }
+
     static bool classof(const ExprAST *E) {
         return E->getKind() == Expr_BinOp;
     }
@@ -137,6 +200,12 @@ public:
 
     std::unique_ptr<ExprAST> &getLHS() { return LHS; }
     std::unique_ptr<ExprAST> &getRHS() { return RHS; }
+
+protected:
+    void takeChildren(ChildList &out) override {
+        out.push_back(std::move(LHS));
+        out.push_back(std::move(RHS));
+    }
 };
 
 class CallExprAST: public ExprAST {
@@ -146,12 +215,22 @@ public:
     CallExprAST(Location Loc, const std::string &Callee, std::vector<std::unique_ptr<ExprAST>> Args)
         : ExprAST(Loc, Expr_Call), Callee(Callee), Args(std::move(Args)) {}
 
+    ~CallExprAST() override { destroyChildren(); }
+
     static bool classof(const ExprAST *E) {
         return E->getKind() == Expr_Call;
     }
 
     const std::string &getCallee() { return Callee; }
     const std::vector<std::unique_ptr<ExprAST>> &getArgs() { return Args; }
+
+protected:
+    void takeChildren(ChildList &out) override {
+        for (auto &arg : Args) {
+            out.push_back(std::move(arg));
+        }
+        Args.clear();
+    }
 };
 
 class ExprASTList {
@@ -186,7 +265,14 @@ public:
     std::vector<std::unique_ptr<FunctionExprAST>> &getFunctions() { return Functions; }
 };
 
+// Checked downcast in the spirit of llvm::dyn_cast, driven by `classof`.
+template <typename T>
+T *dyn_cast(ExprAST *E) {
+    return E && T::classof(E) ? static_cast<T *>(E) : nullptr;
+}
+
 void dump(ModuleAST &module);
+void dump(ModuleAST &module, std::ostream &os);
 };
 
 #endif // AST_HPP
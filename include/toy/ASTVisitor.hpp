@@ -0,0 +1,215 @@
+#ifndef AST_VISITOR_HPP
+#define AST_VISITOR_HPP
+#include <vector>
+#include "AST.hpp"
+
+namespace toy {
+
+// Adding a kind to ExprAST::ExprASTKind must be matched by a case in
+// ASTVisitor::visit and ASTWalker::Callback and, if the kind has children,
+// in ASTWalker::ChildAt.
+static_assert(ExprAST::Expr_KindCount == 10, "ASTVisitor and ASTWalker must handle every ExprASTKind");
+
+// Statically dispatched visitor. `Derived` overrides the visitX methods for
+// the node kinds it handles; the rest fall through to visitExpr. Dispatch is
+// a single switch with no default, compiled with -Wswitch as an error, so a
+// missing kind fails the build.
+//
+//   struct CountCalls : ASTVisitor<CountCalls, int> {
+//       int visitCall(CallExprAST *) { return 1; }
+//       int visitExpr(ExprAST *) { return 0; }
+//   };
+template <typename Derived, typename RetTy = void>
+class ASTVisitor {
+public:
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Wswitch"
+#endif
+    RetTy visit(ExprAST *expr) {
+        switch (expr->getKind()) {
+            case ExprAST::Expr_VarDecl:
+                return derived().visitVarDecl(static_cast<VarDeclExprAST *>(expr));
+            case ExprAST::Expr_Return:
+                return derived().visitReturn(static_cast<ReturnExprAST *>(expr));
+            case ExprAST::Expr_Num:
+                return derived().visitNumber(static_cast<NumberExprAST *>(expr));
+            case ExprAST::Expr_String:
+                return derived().visitString(static_cast<StringExprAST *>(expr));
+            case ExprAST::Expr_Literal:
+                return derived().visitLiteral(static_cast<LiteralExprAST *>(expr));
+            case ExprAST::Expr_Var:
+                return derived().visitVariable(static_cast<VariableExprAST *>(expr));
+            case ExprAST::Expr_BinOp:
+                return derived().visitBinOp(static_cast<BinOpExprAST *>(expr));
+            case ExprAST::Expr_Call:
+                return derived().visitCall(static_cast<CallExprAST *>(expr));
+            case ExprAST::Expr_Print:
+                // print is parsed as a CallExprAST; no node class has this kind.
+                return derived().visitExpr(expr);
+            case ExprAST::Expr_Prototype:
+                return derived().visitPrototype(static_cast<PrototypeExprAST *>(expr));
+            case ExprAST::Expr_KindCount:
+                break;
+        }
+        return derived().visitExpr(expr);
+    }
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+    RetTy visitVarDecl(VarDeclExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitReturn(ReturnExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitNumber(NumberExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitString(StringExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitLiteral(LiteralExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitVariable(VariableExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitBinOp(BinOpExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitCall(CallExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitPrototype(PrototypeExprAST *expr) { return derived().visitExpr(expr); }
+    RetTy visitExpr(ExprAST *) { return RetTy(); }
+
+private:
+    Derived &derived() { return static_cast<Derived &>(*this); }
+};
+
+// Result of a walk callback, in the spirit of mlir::WalkResult.
+enum class WalkResult {
+    Advance,   // continue the walk
+    Skip,      // do not visit this node's children (pre-order only)
+    Interrupt, // stop the whole walk
+};
+
+// Statically dispatched traversal over functions and expressions. `Derived`
+// may define `WalkResult enter(NodeT *)` (pre-order) and
+// `WalkResult leave(NodeT *)` (post-order) overloads for any node classes,
+// plus enter/leave for FunctionExprAST. Nodes without a matching overload
+// resolve to the catch-all templates below, which compile away. Derived
+// classes bring those in with `using ASTWalker::enter; using ASTWalker::leave;`.
+template <typename Derived>
+class ASTWalker {
+public:
+    // Returns false if the walk was interrupted.
+    bool walk(ModuleAST &module) {
+        for (auto &func : module.getFunctions()) {
+            if (!walk(func.get())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool walk(FunctionExprAST *func) {
+        WalkResult res = derived().enter(func);
+        if (res == WalkResult::Interrupt) {
+            return false;
+        }
+        if (res == WalkResult::Advance) {
+            if (!walk(func->getProto().get())) {
+                return false;
+            }
+            for (auto &expr : func->getBlock()->getExprs()) {
+                if (!walk(expr.get())) {
+                    return false;
+                }
+            }
+        }
+        return derived().leave(func) != WalkResult::Interrupt;
+    }
+
+    // Iterative: nodes whose children are still being visited live on an
+    // explicit stack, so depth is not limited by the native stack.
+    bool walk(ExprAST *root) {
+        struct Frame {
+            ExprAST *node;
+            size_t next;
+        };
+        std::vector<Frame> stack;
+        ExprAST *node = root;
+        while (true) {
+            if (node) {
+                WalkResult res = Callback<false>(derived()).visit(node);
+                if (res == WalkResult::Interrupt) {
+                    return false;
+                }
+                if (res == WalkResult::Advance) {
+                    stack.push_back({node, 0});
+                } else if (Callback<true>(derived()).visit(node) == WalkResult::Interrupt) {
+                    return false;
+                }
+            }
+            if (stack.empty()) {
+                return true;
+            }
+            Frame &top = stack.back();
+            node = ChildAt(top.next++).visit(top.node);
+            if (!node) {
+                ExprAST *done = top.node;
+                stack.pop_back();
+                if (Callback<true>(derived()).visit(done) == WalkResult::Interrupt) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    template <typename NodeT>
+    WalkResult enter(NodeT *) { return WalkResult::Advance; }
+    template <typename NodeT>
+    WalkResult leave(NodeT *) { return WalkResult::Advance; }
+
+private:
+    Derived &derived() { return static_cast<Derived &>(*this); }
+
+    // Routes each kind to the typed enter (or leave) overload of `Derived`.
+    template <bool Leave>
+    struct Callback : ASTVisitor<Callback<Leave>, WalkResult> {
+        Callback(Derived &d) : d(d) {}
+        Derived &d;
+
+        template <typename NodeT>
+        WalkResult call(NodeT *e) {
+            if constexpr (Leave) {
+                return d.leave(e);
+            } else {
+                return d.enter(e);
+            }
+        }
+
+        WalkResult visitVarDecl(VarDeclExprAST *e) { return call(e); }
+        WalkResult visitReturn(ReturnExprAST *e) { return call(e); }
+        WalkResult visitNumber(NumberExprAST *e) { return call(e); }
+        WalkResult visitString(StringExprAST *e) { return call(e); }
+        WalkResult visitLiteral(LiteralExprAST *e) { return call(e); }
+        WalkResult visitVariable(VariableExprAST *e) { return call(e); }
+        WalkResult visitBinOp(BinOpExprAST *e) { return call(e); }
+        WalkResult visitCall(CallExprAST *e) { return call(e); }
+        WalkResult visitPrototype(PrototypeExprAST *e) { return call(e); }
+        WalkResult visitExpr(ExprAST *e) { return call(e); }
+    };
+
+    // Returns child `index` of a node, or null past the last one.
+    struct ChildAt : ASTVisitor<ChildAt, ExprAST *> {
+        ChildAt(size_t index) : index(index) {}
+        size_t index;
+
+        ExprAST *visitVarDecl(VarDeclExprAST *e) { return index == 0 ? e->getExpr().get() : nullptr; }
+        ExprAST *visitReturn(ReturnExprAST *e) { return index == 0 ? e->getValue().get() : nullptr; }
+        ExprAST *visitLiteral(LiteralExprAST *e) { return at(e->getValues()); }
+        ExprAST *visitBinOp(BinOpExprAST *e) {
+            return index == 0 ? e->getLHS().get() : index == 1 ? e->getRHS().get() : nullptr;
+        }
+        ExprAST *visitCall(CallExprAST *e) { return at(e->getArgs()); }
+        ExprAST *visitPrototype(PrototypeExprAST *e) { return at(e->getArgs()); }
+        ExprAST *visitExpr(ExprAST *) { return nullptr; }
+
+        template <typename Range>
+        ExprAST *at(Range &range) {
+            return index < range.size() ? range[index].get() : nullptr;
+        }
+    };
+};
+
+};
+
+#endif // AST_VISITOR_HPP
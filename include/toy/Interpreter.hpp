@@ -0,0 +1,87 @@
+#ifndef INTERPRETER_HPP
+#define INTERPRETER_HPP
+#include <initializer_list>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AST.hpp"
+#include "Print.hpp"
+#include "Profile.hpp"
+#include "Tensor.hpp"
+
+namespace toy {
+
+struct RunOptions {
+    PrintOptions print;
+    // Element type of number and tensor literals. Declarations that do not
+    // name a type keep the type of their value.
+    ElementType defaultType = ElementType::F64;
+    // Threads used by compute kernels; 0 picks the hardware concurrency.
+    unsigned threads = 0;
+    // Collects an execution profile when set. Unset, profiling costs one
+    // pointer test per evaluated operation.
+    Profiler *profiler = nullptr;
+};
+
+// Tree-walking evaluator for a parsed module. Functions are generic over the
+// shapes of their arguments; every call checks shapes as it evaluates.
+// Binary operations on mixed element types promote to the wider type; a
+// declaration that names an element type converts its value to it. A <1,1>
+// operand of a binary operation broadcasts against the other operand.
+//
+// Builtins:
+//   transpose(a)             swap rows and columns
+//   matmul(a, b)             matrix product of <m,k> and <k,n>
+//   sum(a), mean(a), max(a)  reduce to <1,1>; an axis argument of 0 reduces
+//                            over rows to <1,cols>, 1 over columns to <rows,1>
+//   print(a)                 write `a` to the output stream
+//   load("path", rows, cols) map a tensor file without copying it
+//   store(a, "path")         stream `a` to a tensor file
+class Interpreter {
+public:
+    Interpreter(ModuleAST &module, std::ostream &out, std::ostream &errs,
+                const RunOptions &options = RunOptions());
+
+    // Evaluate `main`. Returns false if evaluation failed.
+    bool run();
+
+private:
+    using Scope = std::unordered_map<std::string, Tensor>;
+
+    // Calls nested deeper than this are reported instead of overflowing the stack.
+    static constexpr int MaxCallDepth = 1000;
+    // Likewise for expressions being evaluated, counted across calls; about
+    // 2 KiB of stack each in a debug build.
+    static constexpr int MaxExprDepth = 2000;
+
+    std::optional<Tensor> callFunction(FunctionExprAST *func, std::vector<Tensor> args, const Location &loc);
+    std::optional<Tensor> eval(ExprAST *expr, Scope &scope);
+    std::optional<Tensor> evalKind(ExprAST *expr, Scope &scope);
+    std::optional<Tensor> eval(VariableExprAST *expr, Scope &scope);
+    std::optional<Tensor> eval(VarDeclExprAST *expr, Scope &scope);
+    std::optional<Tensor> eval(BinOpExprAST *expr, Scope &scope);
+    std::optional<Tensor> eval(CallExprAST *expr, Scope &scope);
+    std::optional<Tensor> eval(LiteralExprAST *expr);
+    std::optional<Tensor> eval(NumberExprAST *expr);
+    std::optional<Tensor> evalBuiltin(CallExprAST *expr, Scope &scope);
+
+    // Reports to the profiler, if any, that `result` was computed from `inputs`.
+    Tensor account(Tensor result, std::initializer_list<const Tensor *> inputs);
+    // `t` as `type`, accounting for the copy if it converts.
+    Tensor convert(const Tensor &t, ElementType type);
+
+    std::optional<Tensor> runtimeError(const Location &loc, const std::string &msg);
+
+    std::ostream &out;
+    std::ostream &errs;
+    RunOptions options;
+    std::unordered_map<std::string, FunctionExprAST *> functions;
+    int callDepth = 0;
+    int exprDepth = 0;
+};
+
+};
+
+#endif // INTERPRETER_HPP
@@ -0,0 +1,22 @@
+#ifndef LAZY_PARSER_HPP
+#define LAZY_PARSER_HPP
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AST.hpp"
+
+namespace toy {
+
+// Parses only the functions reachable from `main`. Every prototype is parsed
+// but bodies are skipped by brace matching; a body is parsed when a call to
+// its function is first found while following the call graph from `main`.
+// Functions never reached are left out of the module, so syntax errors in
+// their bodies go unreported; if `unreachable` is set, their prototypes are
+// appended to it. Returns null on a syntax error, reported to `errs`.
+std::unique_ptr<ModuleAST> parseReachable(const std::string &filename, std::ostream &errs,
+                                          std::vector<std::unique_ptr<PrototypeExprAST>> *unreachable = nullptr);
+
+};
+
+#endif // LAZY_PARSER_HPP
@@ -1,9 +1,11 @@
 
 #ifndef LEXER_HPP
 #define LEXER_HPP
+#include <memory>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 namespace toy {
 
@@ -16,6 +18,7 @@ enum Token {
     tok_number = -4,
     tok_identifier = -5,
     tok_return = -6,
+    tok_string = -7,
 
     tok_semicolon = ';',
     tok_parenthese_open = '(',
@@ -45,11 +48,32 @@ public:
         CurTok = 0;
         Filename = filename;
         location = {std::make_shared<std::string>(filename), 1, 0};
-        file = new std::ifstream(filename);
-        if (!file->is_open()) {
+        auto f = std::make_unique<std::ifstream>(filename);
+        if (!f->is_open()) {
             std::cerr << "Error opening file: " << filename << std::endl;
             exit(1);
         }
+        file = std::move(f);
+    }
+
+    // Lex an in-memory buffer; `filename` is only used for locations.
+    Lexer(std::string filename, std::string buffer) {
+        IdentifierStr = "";
+        NumVal = 0;
+        Line = 1;
+        Column = 0;
+        CurTok = 0;
+        Filename = filename;
+        location = {std::make_shared<std::string>(filename), 1, 0};
+        file = std::make_unique<std::istringstream>(std::move(buffer));
+    }
+
+    // Lex `buffer` as source text that starts at `line`:`column` of
+    // `filename`, e.g. a function body parsed on its own.
+    Lexer(std::string filename, std::string buffer, size_t line, size_t column)
+        : Lexer(std::move(filename), std::move(buffer)) {
+        Line = line;
+        Column = column - 1;
     }
 
     int CurToken() { return CurTok; }
@@ -58,12 +82,53 @@ public:
     int LineNumber() { return Line; }
     int ColumnNumber() { return Column; }
     Location GetLocation() { return location; }
+    // Offset of the current token's first character in the input.
+    size_t TokenOffset() { return TokOffset; }
 
     std::string GetIdentifier() { return IdentifierStr; }
     double GetNumber() { return NumVal; }
+    std::string GetString() { return StringVal; }
 
     void NextToken() { CurTok = gettokn(); }
 
+    // With '{' as the current token, skip to the matching '}' by counting
+    // braces, without tokenizing. Comments and strings are skipped as the
+    // lexer would, so braces inside them do not count. The '}' becomes the
+    // current token. Returns false at end of input.
+    bool SkipBlock() {
+        int depth = 1;
+        while (LastChar != EOF) {
+            if (LastChar == '#') {
+                while (LastChar != EOF && LastChar != '\n' && LastChar != '\r') {
+                    LastChar = readChar();
+                }
+                continue;
+            }
+            if (LastChar == '"') {
+                do {
+                    LastChar = readChar();
+                } while (LastChar != '"' && LastChar != '\n' && LastChar != EOF);
+                if (LastChar == '"') {
+                    LastChar = readChar();
+                }
+                continue;
+            }
+            if (LastChar == '{') {
+                depth++;
+            } else if (LastChar == '}' && --depth == 0) {
+                location.Line = Line;
+                location.Column = Column;
+                TokOffset = Offset - 1;
+                CurTok = '}';
+                LastChar = readChar();
+                return true;
+            }
+            LastChar = readChar();
+        }
+        CurTok = tok_eof;
+        return false;
+    }
+
     int GetTokPrecedence() {
         switch(CurTok) {
             case '<':
@@ -84,13 +149,17 @@ public:
 private:
     std::string IdentifierStr;
     double NumVal;
+    std::string StringVal;
     size_t Line;
     size_t Column;
     int CurTok;
     std::string Filename;
-    std::ifstream *file;
+    std::unique_ptr<std::istream> file;
     int LastChar = ' ';
     Location location;
+    // Characters read so far, and the offset of the current token.
+    size_t Offset = 0;
+    size_t TokOffset = 0;
 
     int gettokn() {
         // Skip any whitespace.
@@ -99,6 +168,7 @@ private:
         }
         location.Line = Line;
         location.Column = Column;
+        TokOffset = Offset - 1;
 
         if (isalpha(LastChar)) { // identifier: [a-zA-Z][a-zA-Z0-9]*
             IdentifierStr = LastChar;
@@ -130,6 +200,19 @@ private:
             return tok_number;
         }
 
+        // string: '"' [^"\n]* '"'
+        if (LastChar == '"') {
+            StringVal = "";
+            while ((LastChar = readChar()) != '"') {
+                if (LastChar == EOF || LastChar == '\n') {
+                    return '"';
+                }
+                StringVal += LastChar;
+            }
+            LastChar = readChar(); // eat closing '"'
+            return tok_string;
+        }
+
         // Check if the character is a comment
         if (LastChar == '#') {
             // Comment until end of line.
@@ -153,6 +236,7 @@ private:
 
     int readChar() {
         char c = file->get();
+        Offset++;
         Column++;
         if (c == '\n') {
             Line++;
@@ -8,7 +8,7 @@ namespace toy {
 class Parser {
 
 public:
-    Parser(Lexer &lexer) : lexer(lexer) {}
+    Parser(Lexer &lexer, std::ostream &errs = std::cerr) : lexer(lexer), errs(errs) {}
 
     std::unique_ptr<ModuleAST> parseModule() {
         lexer.NextToken();
@@ -23,8 +23,54 @@ public:
 
         return std::make_unique<ModuleAST>(std::move(functions));
     }
+
+    // A function whose body has not been parsed: its prototype and the input
+    // span of its body, from '{' through the matching '}'.
+    struct FunctionDecl {
+        Location loc;
+        std::unique_ptr<PrototypeExprAST> proto;
+        Location bodyLoc;
+        size_t bodyBegin;
+        size_t bodyEnd;
+    };
+
+    // Parses every prototype in the module but skips each body by brace
+    // matching, to be parsed later with parseBody(). Returns false on a
+    // syntax error.
+    bool parseDeclarations(std::vector<FunctionDecl> &decls) {
+        lexer.NextToken();
+        while (lexer.CurToken() != tok_eof) {
+            auto loc = lexer.GetLocation();
+            auto proto = parsePrototype();
+            if (!proto) {
+                return false;
+            }
+            if (lexer.CurToken() != tok_bracket_open) {
+                parseError<ExprASTList>("Expected '{' in block");
+                return false;
+            }
+            auto bodyLoc = lexer.GetLocation();
+            size_t bodyBegin = lexer.TokenOffset();
+            if (!lexer.SkipBlock()) {
+                parseError<ExprASTList>("Expected '}' in block");
+                return false;
+            }
+            size_t bodyEnd = lexer.TokenOffset() + 1;
+            lexer.NextToken(); // eat '}'
+            decls.push_back({loc, std::move(proto), bodyLoc, bodyBegin, bodyEnd});
+        }
+        return true;
+    }
+
+    // Parses a body recorded by parseDeclarations(), from a lexer over just
+    // that span.
+    std::unique_ptr<ExprASTList> parseBody() {
+        lexer.NextToken();
+        return parseBlock();
+    }
 private:
     Lexer &lexer;
+    std::ostream &errs;
 
     // prototype ::= def id '(' decl_list ')'
     // decl_list ::= id | id, decl_list
@@ -60,36 +106,6 @@ private:
         return std::make_unique<PrototypeExprAST>(loc, name, std::move(args));
     }
 
-    std::unique_ptr<ExprAST> parseIdentifier() {
-        auto loc = lexer.GetLocation();
-        if (lexer.CurToken() != tok_identifier) {
-            return parseError<ExprAST>("Expected identifier");
-        }
-        std::string name = lexer.GetIdentifier();
-        lexer.NextToken(); // eat identifier
-        if (lexer.CurToken() != tok_parenthese_open) {
-            return std::make_unique<VariableExprAST>(loc, name);
-        }
-        lexer.NextToken(); // eat '('
-        std::vector<std::unique_ptr<ExprAST>> args;
-        while (lexer.CurToken() != tok_parenthese_close) {
-            auto arg = parseExpression();
-            if (!arg) {
-                return nullptr;
-            }
-            args.push_back(std::move(arg));
-            if (lexer.CurToken() != ',') {
-                break;
-            }
-            lexer.NextToken(); // eat ','
-        }
-        if (lexer.CurToken() != tok_parenthese_close) {
-            return parseError<ExprAST>("Expected ')' in function call");
-        }
-        lexer.NextToken(); // eat ')'
-        return std::make_unique<CallExprAST>(loc, name, std::move(args));    
-    }
-
     std::unique_ptr<NumberExprAST> parseNumber() {
         auto loc = lexer.GetLocation();
         if (lexer.CurToken() != tok_number) {
@@ -100,126 +116,217 @@ private:
         return std::make_unique<NumberExprAST>(loc, val);
     }
 
-    std::unique_ptr<ExprAST> parseParentExpr() {
-        if (lexer.CurToken() != tok_parenthese_open) {
-            return parseError<ExprAST>("Expected '(' in expression");
-        }
-        lexer.NextToken(); // eat '('
-        auto expr = parseExpression();
-        if (!expr) {
-            return nullptr;
-        }
-        if (lexer.CurToken() != tok_parenthese_close) {
-            return parseError<ExprAST>("Expected ')' in expression");
+    std::unique_ptr<StringExprAST> parseString() {
+        auto loc = lexer.GetLocation();
+        if (lexer.CurToken() != tok_string) {
+            return parseError<StringExprAST>("Expected string");
         }
-        lexer.NextToken(); // eat ')'
-        return expr;
+        std::string val = lexer.GetString();
+        lexer.NextToken(); // eat string
+        return std::make_unique<StringExprAST>(loc, val);
     }
 
     // tensorLiteral ::= [tensorLiteral | tensorLiteral]
     // tensorLiteral ::= [number | number]
+    //
+    // Nested brackets are kept on an explicit stack of open literals rather
+    // than parsed recursively, so nesting depth is bounded by memory only.
     std::unique_ptr<ExprAST> parseTensorLiteral() {
-        auto loc = lexer.GetLocation();
+        struct OpenLiteral {
+            Location loc;
+            std::vector<std::unique_ptr<ExprAST>> values;
+            bool isTensor = false;
+            bool isNumber = false;
+            int col = -1;
+        };
         if (lexer.CurToken() != tok_sbracket_open) {
             return parseError<ExprAST>("Expected '[' in tensor literal");
         }
+        std::vector<OpenLiteral> open;
+        open.push_back({lexer.GetLocation()});
         lexer.NextToken(); // eat '['
-        std::vector<std::unique_ptr<ExprAST>> values;
-        bool isTensor = false;
-        bool isNumber = false;
-        int col = -1;
-        while (lexer.CurToken() != tok_sbracket_close) {
+        while (true) {
+            // An element, unless the literal is empty or ends in ','.
+            OpenLiteral &lit = open.back();
             if (lexer.CurToken() == tok_sbracket_open) {
-                if (isNumber) {
+                if (lit.isNumber) {
                     return parseError<ExprAST>("Number is mixed with tensor");
                 }
-                auto v = parseTensorLiteral();
-                if (!v) {
-                    return nullptr;
-                }
-                auto vv = static_cast<LiteralExprAST*>(v.get());
-                if (col == -1) {
-                    col = vv->getType().shape[0];
-                }
-                if (col != vv->getType().shape[0]) {
-                    return parseError<ExprAST>("All tensors should have the same shape");
-                }
-                values.push_back(std::move(v));
-                isTensor = true;
-            } else if (lexer.CurToken() == tok_number) {
-                if (isTensor) {
+                open.push_back({lexer.GetLocation()});
+                lexer.NextToken(); // eat '['
+                continue;
+            }
+            if (lexer.CurToken() == tok_number) {
+                if (lit.isTensor) {
                     return parseError<ExprAST>("Number is mixed with tensor");
                 }
-                col = 1;
-                auto v = parseNumber();
-                values.push_back(std::move(v));
-                isNumber = true;
-            } else {
+                lit.col = 1;
+                lit.values.push_back(parseNumber());
+                lit.isNumber = true;
+            } else if (lexer.CurToken() != tok_sbracket_close) {
                 return parseError<ExprAST>("Expected number or tensor");
             }
-            if (lexer.CurToken() != ',') {
-                break;
+            // ',' before the next element, or ']' closing this literal and
+            // possibly several enclosing ones.
+            while (true) {
+                if (lexer.CurToken() == ',') {
+                    lexer.NextToken(); // eat ','
+                    break;
+                }
+                if (lexer.CurToken() != tok_sbracket_close) {
+                    return parseError<ExprAST>("Expected ']' in tensor literal");
+                }
+                lexer.NextToken(); // eat ']'
+                OpenLiteral &done = open.back();
+                VarType dims;
+                dims.shape.push_back(done.values.size());
+                dims.shape.push_back(done.col);
+                auto res = std::make_unique<LiteralExprAST>(done.loc, std::move(done.values), std::move(dims));
+                open.pop_back();
+                if (open.empty()) {
+                    return res;
+                }
+                OpenLiteral &parent = open.back();
+                int rows = res->getType().shape[0];
+                if (parent.col == -1) {
+                    parent.col = rows;
+                }
+                if (parent.col != rows) {
+                    return parseError<ExprAST>("All tensors should have the same shape");
+                }
+                parent.values.push_back(std::move(res));
+                parent.isTensor = true;
             }
-            lexer.NextToken(); // eat ','
         }
-        VarType dims;
-        dims.shape.push_back(values.size());
-        dims.shape.push_back(col);
-        lexer.NextToken(); // eat ']'
-        auto res = std::make_unique<LiteralExprAST>(loc, std::move(values), std::move(dims));
-        return res;
     }
 
-    std::unique_ptr<ExprAST> parsePrimary() {
-        switch(lexer.CurToken()) {
-            case tok_identifier:
-                return parseIdentifier();
-            case tok_number:
-                return parseNumber();
-            case tok_parenthese_open:
-                return parseParentExpr();
-            case tok_sbracket_open:
-                return parseTensorLiteral();
-            default:
-                return parseError<ExprAST>("Expected primary expression");
+    // A binary operator waiting for its right operand.
+    struct PendingOp {
+        int op;
+        int precedence;
+        Location loc;
+    };
+
+    // An expression being parsed. Parentheses and call arguments open a
+    // nested frame; each frame has its own operand and operator stacks.
+    struct ExprFrame {
+        enum Kind { Top, Paren, CallArg } kind;
+        // Callee and arguments parsed so far, for CallArg.
+        Location loc;
+        std::string callee;
+        std::vector<std::unique_ptr<ExprAST>> args;
+        std::vector<std::unique_ptr<ExprAST>> operands;
+        std::vector<PendingOp> ops;
+    };
+
+    // Folds pending operators that bind at least as tightly as `precedence`
+    // into BinOp nodes. Folding equal precedence keeps operators left
+    // associative.
+    static void reduce(ExprFrame &frame, int precedence) {
+        while (!frame.ops.empty() && frame.ops.back().precedence >= precedence) {
+            PendingOp op = frame.ops.back();
+            frame.ops.pop_back();
+            auto right = std::move(frame.operands.back());
+            frame.operands.pop_back();
+            auto left = std::move(frame.operands.back());
+            frame.operands.back() = std::make_unique<BinOpExprAST>(op.loc, op.op, std::move(left), std::move(right));
         }
     }
 
-    // binoprhs ::= ('+' primary)*
-    std::unique_ptr<ExprAST> parseBinOpRHS(int precedence, std::unique_ptr<ExprAST> left) {
+    // expr    ::= primary (binop primary)*
+    // primary ::= identifier | identifier '(' [expr (',' expr)*] ')'
+    //           | number | string | '(' expr ')' | tensorLiteral
+    //
+    // Precedence climbing over explicit stacks, using the precedences from
+    // Lexer::GetTokPrecedence. Nothing here recurses per operator or per
+    // nesting level, so long operator chains and deep parentheses parse in
+    // linear time and constant native stack.
+    std::unique_ptr<ExprAST> parseExpression() {
+        std::vector<ExprFrame> frames;
+        frames.push_back({ExprFrame::Top});
         while (true) {
-            auto loc = lexer.GetLocation();
-            int tokPrecedence = lexer.GetTokPrecedence();
-            if (tokPrecedence < precedence) {
-                return left;
-            }
-            int binOp = lexer.CurToken();
-            lexer.NextToken(); // eat binop
-            auto right = parsePrimary();
-            if (!right) {
-                return nullptr;
-            }
-            int nextPrecedence = lexer.GetTokPrecedence();
-            if (tokPrecedence < nextPrecedence) {
-                right = parseBinOpRHS(tokPrecedence + 1, std::move(right));
-                if (!right) {
-                    return nullptr;
+            // An operand, or the opening of a nested frame.
+            std::unique_ptr<ExprAST> operand;
+            switch (lexer.CurToken()) {
+                case tok_parenthese_open:
+                    lexer.NextToken(); // eat '('
+                    frames.push_back({ExprFrame::Paren});
+                    continue;
+                case tok_identifier: {
+                    auto loc = lexer.GetLocation();
+                    std::string name = lexer.GetIdentifier();
+                    lexer.NextToken(); // eat identifier
+                    if (lexer.CurToken() != tok_parenthese_open) {
+                        operand = std::make_unique<VariableExprAST>(loc, name);
+                        break;
+                    }
+                    lexer.NextToken(); // eat '('
+                    if (lexer.CurToken() != tok_parenthese_close) {
+                        frames.push_back({ExprFrame::CallArg, loc, name});
+                        continue;
+                    }
+                    lexer.NextToken(); // eat ')'
+                    operand = std::make_unique<CallExprAST>(loc, name, std::vector<std::unique_ptr<ExprAST>>());
+                    break;
                 }
+                case tok_number:
+                    operand = parseNumber();
+                    break;
+                case tok_string:
+                    operand = parseString();
+                    break;
+                case tok_sbracket_open:
+                    operand = parseTensorLiteral();
+                    if (!operand) {
+                        return nullptr;
+                    }
+                    break;
+                default:
+                    return parseError<ExprAST>("Expected primary expression");
             }
-            left = std::make_unique<BinOpExprAST>(loc, binOp, std::move(left), std::move(right));
-        }
-    }
+            frames.back().operands.push_back(std::move(operand));
 
-    // expr = prototype*expr
-    // expr = identifier
-    // expr = literal
-    std::unique_ptr<ExprAST> parseExpression() {
-        auto loc = lexer.GetLocation();
-        auto left = parsePrimary();
-        if (!left) {
-            return nullptr;
+            // A binary operator, or the end of one or more frames.
+            while (true) {
+                ExprFrame &frame = frames.back();
+                int precedence = lexer.GetTokPrecedence();
+                if (precedence >= 0) {
+                    reduce(frame, precedence);
+                    frame.ops.push_back({lexer.CurToken(), precedence, lexer.GetLocation()});
+                    lexer.NextToken(); // eat binop
+                    break;
+                }
+                reduce(frame, 0);
+                auto expr = std::move(frame.operands.back());
+                frame.operands.pop_back();
+                if (frame.kind == ExprFrame::Top) {
+                    return expr;
+                }
+                if (frame.kind == ExprFrame::Paren) {
+                    if (lexer.CurToken() != tok_parenthese_close) {
+                        return parseError<ExprAST>("Expected ')' in expression");
+                    }
+                    lexer.NextToken(); // eat ')'
+                    frames.pop_back();
+                    frames.back().operands.push_back(std::move(expr));
+                    continue;
+                }
+                frame.args.push_back(std::move(expr));
+                if (lexer.CurToken() == ',') {
+                    lexer.NextToken(); // eat ','
+                    if (lexer.CurToken() != tok_parenthese_close) {
+                        break;
+                    }
+                }
+                if (lexer.CurToken() != tok_parenthese_close) {
+                    return parseError<ExprAST>("Expected ')' in function call");
+                }
+                lexer.NextToken(); // eat ')'
+                auto call = std::make_unique<CallExprAST>(frame.loc, frame.callee, std::move(frame.args));
+                frames.pop_back();
+                frames.back().operands.push_back(std::move(call));
+            }
         }
-        return parseBinOpRHS(0, std::move(left));
     }
 
     std::unique_ptr<VarDeclExprAST> parseVarDecl() {
@@ -237,9 +344,26 @@ private:
         lexer.NextToken(); // eat identifier
         VarType type;
         // check if type specified
+        // type ::= '<' [elementType [',']] [number ',' number] '>'
         if (lexer.CurToken() == tok_brace_open) {
             std::vector<int> shape;
             lexer.NextToken(); // eat '<'
+            bool needShape = true;
+            if (lexer.CurToken() == tok_identifier) {
+                ElementType elementType;
+                if (!parseElementType(lexer.GetIdentifier(), elementType)) {
+                    return parseError<VarDeclExprAST>("Unknown element type '" + lexer.GetIdentifier() + "'");
+                }
+                type.elementType = elementType;
+                lexer.NextToken(); // eat element type
+                if (lexer.CurToken() != ',' && lexer.CurToken() != tok_brace_close) {
+                    return parseError<VarDeclExprAST>("Expected ',' or '>' after element type");
+                }
+                needShape = lexer.CurToken() == ',';
+                if (needShape) {
+                    lexer.NextToken(); // eat ','
+                }
+            }
             while(lexer.CurToken()== tok_number) {
                 shape.push_back(lexer.GetNumber());
                 lexer.NextToken(); // eat number
@@ -255,7 +379,7 @@ private:
                 return parseError<VarDeclExprAST>("Expected '>' in type");
             }
 
-            if (shape.size() != 2) {
+            if ((needShape || !shape.empty()) && shape.size() != 2) {
                 return parseError<VarDeclExprAST>("Expected 2 numbers in type but got " + std::to_string(shape.size()));
             }
             lexer.NextToken(); // eat '>'
@@ -356,7 +480,7 @@ private:
 
     template<typename R>
     std::unique_ptr<R> parseError(const std::string &msg) {
-        std::cerr << "Error: " << msg << " at line " << lexer.LineNumber() << " column " << lexer.ColumnNumber() << std::endl;
+        errs << "Error: " << msg << " at line " << lexer.LineNumber() << " column " << lexer.ColumnNumber() << std::endl;
         return nullptr;
     }
 };
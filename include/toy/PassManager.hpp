@@ -0,0 +1,57 @@
+#ifndef PASS_MANAGER_HPP
+#define PASS_MANAGER_HPP
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AST.hpp"
+
+namespace toy {
+
+// A transformation or analysis over a whole module. Passes traverse the AST
+// with ASTVisitor/ASTWalker; the only virtual call is the one per pass.
+class Pass {
+public:
+    virtual ~Pass() {}
+
+    virtual const char *getName() const = 0;
+
+    // Returns false if the module is invalid and the pipeline should stop.
+    virtual bool run(ModuleAST &module) = 0;
+};
+
+// Runs passes in the order they were added, stopping at the first failure.
+class PassManager {
+public:
+    void addPass(std::unique_ptr<Pass> pass) { passes.push_back({std::move(pass), 0}); }
+
+    template <typename PassT, typename... Args>
+    void addPass(Args &&...args) {
+        addPass(std::make_unique<PassT>(std::forward<Args>(args)...));
+    }
+
+    // Record wall time per pass, reported by printTimings().
+    void enableTiming(bool enable = true) { timing = enable; }
+
+    bool run(ModuleAST &module);
+
+    void printTimings(std::ostream &os) const;
+
+private:
+    struct Entry {
+        std::unique_ptr<Pass> pass;
+        double seconds;
+    };
+
+    std::vector<Entry> passes;
+    bool timing = false;
+};
+
+// Checks names and arities: every variable is declared before use and not
+// redeclared, every callee is a function or builtin, and calls pass as many
+// arguments as the callee takes. Errors are reported to `errs`.
+std::unique_ptr<Pass> createVerifierPass(std::ostream &errs);
+
+};
+
+#endif // PASS_MANAGER_HPP
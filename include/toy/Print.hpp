@@ -0,0 +1,23 @@
+#ifndef PRINT_HPP
+#define PRINT_HPP
+#include <ostream>
+#include "Tensor.hpp"
+
+namespace toy {
+
+struct PrintOptions {
+    // Write the tensor file format used by store() instead of text.
+    bool binary = false;
+    // Threads used to format large tensors; 0 picks the hardware concurrency.
+    unsigned threads = 0;
+};
+
+// Write `t` to `out`. Text output has one row per line with elements separated
+// by a space, each formatted as the shortest string that round-trips to the
+// same value of its element type. Output is staged in large buffers; `out` is
+// not flushed.
+void printTensor(const Tensor &t, std::ostream &out, const PrintOptions &options);
+
+};
+
+#endif // PRINT_HPP
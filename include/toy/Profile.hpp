@@ -0,0 +1,109 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "AST.hpp"
+#include "Tensor.hpp"
+
+namespace toy {
+
+// Instrumenting profiler for the interpreter. Each operation (binary operator,
+// call or tensor literal, identified by its source location) and each function
+// specialization (a function and the shapes of its arguments) is a site. The
+// interpreter brackets every evaluation of a site with enter()/leave() and
+// reports the bytes an operation allocates and moves with addBytes().
+//
+// An operation's self time excludes evaluating its operands. A function's self
+// time excludes only its callees, and it is charged the bytes of every
+// operation in its own body. Total time counts the outermost activation of a
+// recursive site once.
+class Profiler {
+public:
+    Profiler();
+
+    void enter(ExprAST *expr);
+    void enterFunction(FunctionExprAST *func, const std::vector<Tensor> &args);
+
+    // Closes the innermost site. `result` is null if evaluation failed.
+    void leave(const Tensor *result);
+
+    // Charges the innermost site and its enclosing function.
+    void addBytes(size_t allocated, size_t moved);
+
+    // Writes the `top` operations and the `top` functions with the most self
+    // time, one table each.
+    void report(std::ostream &os, size_t top) const;
+
+    // Writes one `frame;frame;...;frame <self ns>` line per distinct stack,
+    // the collapsed format read by flamegraph.pl and compatible tools.
+    void writeCollapsed(std::ostream &os) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t None = size_t(-1);
+
+    struct Shape {
+        size_t rows;
+        size_t cols;
+        ElementType type;
+
+        bool operator==(const Shape &other) const {
+            return rows == other.rows && cols == other.cols && type == other.type;
+        }
+    };
+
+    struct Site {
+        std::string name;
+        bool function;
+        uint64_t calls = 0;
+        double selfSeconds = 0;
+        double totalSeconds = 0;
+        uint64_t allocated = 0;
+        uint64_t moved = 0;
+        // Distinct result shapes, up to MaxShapes.
+        std::vector<Shape> shapes;
+        bool moreShapes = false;
+        int active = 0;
+    };
+
+    // One active evaluation of a site.
+    struct Frame {
+        size_t site;
+        size_t node;
+        // Index in `frames` of the innermost function frame, possibly this one.
+        size_t function;
+        Clock::time_point start;
+        double nestedSeconds = 0;
+        double nestedCallSeconds = 0;
+    };
+
+    // A node of the calling-context tree; nodes[0] is the root.
+    struct Node {
+        size_t site;
+        size_t parent;
+        double selfSeconds = 0;
+        std::unordered_map<size_t, size_t> children;
+    };
+
+    static constexpr size_t MaxShapes = 4;
+
+    void push(size_t site, bool function);
+    void writeTable(std::ostream &os, bool functions, size_t top) const;
+
+    std::vector<Site> sites;
+    std::unordered_map<ExprAST *, size_t> exprSites;
+    // Specializations of each function: argument shapes and site.
+    std::unordered_map<FunctionExprAST *, std::vector<std::pair<std::vector<Shape>, size_t>>> functionSites;
+    std::vector<Shape> argShapes;
+    std::vector<Frame> frames;
+    std::vector<Node> nodes;
+};
+
+};
+
+#endif // PROFILE_HPP
@@ -0,0 +1,90 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "AST.hpp"
+
+namespace toy {
+
+// Wire protocol (one or more requests per connection):
+//   request  ::= op ' ' name-length ' ' buffer-length '\n' name buffer
+//   response ::= ("ok" | "error") ' ' output-length '\n' output
+// `op` is one of "parse", "dump" or "run".
+struct Response {
+    bool ok;
+    std::string output;
+};
+
+class Server {
+public:
+    // Each `run` request uses at most `requestThreads` threads for its kernels,
+    // so concurrent requests share the machine instead of oversubscribing it.
+    Server(std::string socketPath, unsigned requestThreads = 1)
+        : socketPath(socketPath), requestThreads(requestThreads ? requestThreads : 1) {}
+
+    // Listen on the socket and serve connections until the process is killed.
+    int serve();
+
+    // Handle a single request; safe to call from several threads at once.
+    Response handle(const std::string &op, const std::string &name, const std::string &buffer);
+
+private:
+    // A parsed module together with everything derived from it. Entries are
+    // immutable once published, except for lazily computed products.
+    struct CacheEntry {
+        uint64_t key;
+        std::string name;
+        std::string source;
+        std::unique_ptr<ModuleAST> module;
+        std::string errors;
+        // Estimated memory held by the entry; guarded by cacheMutex.
+        size_t bytes = 0;
+
+        std::once_flag dumpOnce;
+        std::string dumpText;
+    };
+
+    // Upper bound on the estimated memory of cached entries. Least recently
+    // used entries are evicted first; the newest entry is kept even if it is
+    // larger on its own.
+    static constexpr size_t MaxCacheBytes = size_t(1) << 30;
+    // Rough footprint of one AST node, including its allocation overhead.
+    static constexpr size_t AstNodeBytes = 128;
+
+    // Limits on a request; larger ones are answered with an error and the
+    // connection is closed.
+    static constexpr size_t MaxHeaderSize = 256;
+    static constexpr size_t MaxNameSize = 4096;
+    static constexpr size_t MaxBufferSize = size_t(64) << 20;
+
+    // Stack of each connection thread. The interpreter bounds its recursion by
+    // Interpreter::MaxExprDepth, which fits with room to spare even in a debug
+    // build; the default thread stack depends on the environment.
+    static constexpr size_t ConnectionStackSize = size_t(16) << 20;
+
+    std::shared_ptr<CacheEntry> lookup(const std::string &name, const std::string &buffer);
+    // Adds `bytes` to a cached entry and evicts to stay within MaxCacheBytes.
+    // Requires cacheMutex.
+    void charge(CacheEntry &entry, size_t bytes);
+    void serveConnection(int fd);
+
+    std::string socketPath;
+    unsigned requestThreads;
+    std::mutex cacheMutex;
+    // Most recently used first.
+    std::list<std::shared_ptr<CacheEntry>> lru;
+    std::unordered_map<uint64_t, std::list<std::shared_ptr<CacheEntry>>::iterator> cache;
+    size_t cacheBytes = 0;
+};
+
+// Send `op` for `filename` ("-" reads stdin) to the server at `socketPath` and
+// print its output. Returns the process exit code.
+int runClient(const std::string &socketPath, const std::string &op, const std::string &filename);
+
+};
+
+#endif // SERVER_HPP
@@ -0,0 +1,101 @@
+#ifndef TENSOR_HPP
+#define TENSOR_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include "Types.hpp"
+
+namespace toy {
+
+// Runtime value of the language: an immutable, row-major rank-2 tensor of f64
+// or f32.
+// Storage is reference counted and shared between tensors, so reshaping and
+// copying a Tensor never copies elements. Storage may be owned memory or a
+// read-only file mapping.
+class Tensor {
+public:
+    Tensor() : Rows(0), Cols(0), Type(ElementType::F64), Data(nullptr) {}
+
+    // Allocate uninitialized storage. Callers fill it through mutableData()
+    // before the tensor is shared.
+    static Tensor create(size_t rows, size_t cols, ElementType type = ElementType::F64);
+
+    // Map a tensor file read-only. The file is either raw little-endian f64 of
+    // exactly rows*cols elements, or the header format written by store(),
+    // whose element type is taken from the header.
+    // Returns an empty tensor and reports to `errs` on failure.
+    static Tensor load(const std::string &path, size_t rows, size_t cols, std::ostream &errs);
+
+    // Write the tensor in header format, streaming straight from its storage.
+    // The file is replaced atomically, so tensors loaded from it keep their
+    // values.
+    bool store(const std::string &path, std::ostream &errs) const;
+
+    // A view of the same storage with a different shape of equal size.
+    Tensor reshape(size_t rows, size_t cols) const;
+
+    // This tensor with elements of `type`; shares storage if already of `type`.
+    Tensor convert(ElementType type) const;
+
+    size_t rows() const { return Rows; }
+    size_t cols() const { return Cols; }
+    size_t size() const { return Rows * Cols; }
+    bool empty() const { return Data == nullptr; }
+    ElementType elementType() const { return Type; }
+    size_t sizeInBytes() const { return size() * elementSize(Type); }
+
+    // Typed access; T must match elementType().
+    template <typename T>
+    const T *data() const { return static_cast<const T *>(Data); }
+    template <typename T>
+    T *mutableData() { return static_cast<T *>(const_cast<void *>(Data)); }
+    const void *rawData() const { return Data; }
+
+private:
+    size_t Rows;
+    size_t Cols;
+    ElementType Type;
+    const void *Data;
+    std::shared_ptr<const void> Storage;
+};
+
+// Tensor file header: magic, then rows, cols and the ElementType tag as
+// little-endian u64, so that the data is 32-byte aligned within the mapping.
+struct TensorFileHeader {
+    char magic[8];
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t elementType;
+};
+
+constexpr char TensorFileMagic[8] = {'T', 'O', 'Y', 'T', 'N', 'S', 'R', '\0'};
+
+Tensor transpose(const Tensor &t);
+
+// Elementwise `+`, `-`, `*` or `/` on tensors of identical shape and element type.
+Tensor elementwise(char op, const Tensor &lhs, const Tensor &rhs);
+
+// Elementwise `op` between every element of `t` and `scalar`, without
+// materializing a broadcast tensor. `scalarIsLHS` selects `scalar op t`.
+Tensor elementwiseScalar(char op, const Tensor &t, double scalar, bool scalarIsLHS);
+
+enum class ReduceKind {
+    Sum,
+    Mean,
+    Max,
+};
+
+// Reduce all elements to <1,1> (axis -1), over rows to <1,cols> (axis 0) or
+// over columns to <rows,1> (axis 1). Results are deterministic for any
+// `threads` (0 picks the hardware concurrency).
+Tensor reduce(ReduceKind kind, const Tensor &t, int axis, unsigned threads);
+
+// Matrix product of a <m,k> and a <k,n> tensor of the same element type, using
+// up to `threads` threads (0 picks the hardware concurrency).
+Tensor matmul(const Tensor &lhs, const Tensor &rhs, unsigned threads);
+
+};
+
+#endif // TENSOR_HPP
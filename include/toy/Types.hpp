@@ -0,0 +1,42 @@
+#ifndef TYPES_HPP
+#define TYPES_HPP
+#include <cstddef>
+#include <string>
+
+namespace toy {
+
+// Element type of a tensor. The numeric values double as the tag stored in
+// tensor file headers, so they must not change.
+enum class ElementType {
+    F64 = 0,
+    F32 = 1,
+};
+
+inline size_t elementSize(ElementType type) {
+    return type == ElementType::F32 ? sizeof(float) : sizeof(double);
+}
+
+inline const char *elementTypeName(ElementType type) {
+    return type == ElementType::F32 ? "f32" : "f64";
+}
+
+inline bool parseElementType(const std::string &name, ElementType &type) {
+    if (name == "f64") {
+        type = ElementType::F64;
+        return true;
+    }
+    if (name == "f32") {
+        type = ElementType::F32;
+        return true;
+    }
+    return false;
+}
+
+// Mixed-precision operations compute in the wider type, so f32 op f64 is f64.
+inline ElementType promote(ElementType lhs, ElementType rhs) {
+    return lhs == ElementType::F32 && rhs == ElementType::F32 ? ElementType::F32 : ElementType::F64;
+}
+
+};
+
+#endif // TYPES_HPP
@@ -1,4 +1,5 @@
 #include "toy/AST.hpp"
+#include "toy/ASTVisitor.hpp"
 
 #include <iostream> 
 #include <string>
@@ -7,31 +8,41 @@ using namespace toy;
 
 namespace toy {
 
-struct Indent {
-    Indent(int &level) : level(level) { level++; }
-    ~Indent() { level--; }
-    int &level;
-};
-
-class ASTDumper {
+// Prints one line per node, indented by depth. Built on ASTWalker, so deep
+// expressions are dumped without recursion: enter() prints a node one level
+// deeper than its parent and leave() steps back out.
+class ASTDumper : public ASTWalker<ASTDumper> {
 public:
+    ASTDumper(std::ostream &os) : os(os) {}
+
     void dump(ModuleAST *node);
 private:
+    friend class ASTWalker<ASTDumper>;
+
     void dump(FunctionExprAST *node);
-    void dump(PrototypeExprAST *node);
-    void dump(ExprAST *node);
-    void dump(VariableExprAST *node);
-    void dump(VarDeclExprAST *node);
-    void dump(BinOpExprAST *node);
-    void dump(CallExprAST *node);
-    void dump(ExprASTList *node);
-    void dump(ReturnExprAST *node);
-    void dump(LiteralExprAST *node);
-    void dump(NumberExprAST *node);
+
+    WalkResult enter(PrototypeExprAST *node);
+    WalkResult enter(VariableExprAST *node);
+    WalkResult enter(VarDeclExprAST *node);
+    WalkResult enter(BinOpExprAST *node);
+    WalkResult enter(CallExprAST *node);
+    WalkResult enter(ReturnExprAST *node);
+    WalkResult enter(LiteralExprAST *node);
+    WalkResult enter(NumberExprAST *node);
+    WalkResult enter(StringExprAST *node);
+    WalkResult enter(ExprAST *node);
+
+    // The prototype line is not indented; its arguments are.
+    WalkResult leave(PrototypeExprAST *) { return WalkResult::Advance; }
+    WalkResult leave(ExprAST *) {
+        curIndent--;
+        return WalkResult::Advance;
+    }
 
     void indent() {
+        curIndent++;
         for (int i = 0; i < curIndent; i++) {
-            std::cout << "  ";
+            os << "  ";
         }
     }
 
@@ -41,121 +52,97 @@ private:
         return " @" + *loc.Filename + " " + std::to_string(loc.Line) + ":" + std::to_string(loc.Column); 
     }
 
+    std::ostream &os;
     int curIndent = 0;
 };
 
 };
 
-#define INDENT() \
-    Indent level_(curIndent);   \
-    indent();               
-
-
 void ASTDumper::dump(FunctionExprAST *node) {
-    dump(node->getProto().get());
-    dump(node->getBlock().get());
-}
-
-void ASTDumper::dump(PrototypeExprAST *node) {
-    std::cout << "Prototype: " << node->getName();
-    std::cout << loc(node) << std::endl;
-    for (auto &arg : node->getArgs()) {
-        dump(arg.get());
+    walk(node->getProto().get());
+    for (auto &expr : node->getBlock()->getExprs()) {
+        os << "Expr: " << '\n';
+        walk(expr.get());
     }
 }
 
-void ASTDumper::dump(ExprASTList *node) {
-    for (auto &expr : node->getExprs()) {
-        std::cout << "Expr: " << std::endl;
-        dump(expr.get());
-    }
+WalkResult ASTDumper::enter(PrototypeExprAST *node) {
+    os << "Prototype: " << node->getName();
+    os << loc(node) << '\n';
+    return WalkResult::Advance;
 }
 
-void ASTDumper::dump(VariableExprAST *node) {
-    INDENT();
-    std::cout << "Variable: " << node->getName() << loc(node) << std::endl;
+WalkResult ASTDumper::enter(VariableExprAST *node) {
+    indent();
+    os << "Variable: " << node->getName() << loc(node) << '\n';
+    return WalkResult::Advance;
 }
 
-void ASTDumper::dump(ExprAST *node) {
-    switch(node->getKind()) {
-        case ExprAST::Expr_Var:
-            dump(static_cast<VariableExprAST *>(node));
-            break;
-        case ExprAST::Expr_BinOp:
-            dump(static_cast<BinOpExprAST *>(node));
-            break;
-        case ExprAST::Expr_Call:
-            dump(static_cast<CallExprAST *>(node));
-            break;
-        case ExprAST::Expr_VarDecl:
-            dump(static_cast<VarDeclExprAST *>(node));
-            break;
-        case ExprAST::Expr_Return:
-            dump(static_cast<ReturnExprAST *>(node));
-            break;
-        case ExprAST::Expr_Literal:
-            dump(static_cast<LiteralExprAST *>(node));
-            break;
-        case ExprAST::Expr_Num:
-            dump(static_cast<NumberExprAST *>(node));
-            break;
-        default:
-            std::cerr << "Unknown AST node: " << node->getKind() << std::endl;
-            break;
-    }
+WalkResult ASTDumper::enter(ExprAST *node) {
+    curIndent++;
+    std::cerr << "Unknown AST node: " << node->getKind() << std::endl;
+    return WalkResult::Skip;
 }
 
-void ASTDumper::dump(BinOpExprAST *node) {
-    INDENT();
-    std::cout << "BinOp: " << node->getOp() << loc(node) << std::endl;
-    // INDENT();
-    dump(node->getLHS().get());
-    dump(node->getRHS().get());
+WalkResult ASTDumper::enter(BinOpExprAST *node) {
+    indent();
+    os << "BinOp: " << node->getOp() << loc(node) << '\n';
+    return WalkResult::Advance;
 }
 
-void ASTDumper::dump(CallExprAST *node) {
-    INDENT();
-    std::cout << "Call: " << node->getCallee() << loc(node) << std::endl;
-    for (auto &arg : node->getArgs()) {
-        dump(arg.get());
-    }
+WalkResult ASTDumper::enter(CallExprAST *node) {
+    indent();
+    os << "Call: " << node->getCallee() << loc(node) << '\n';
+    return WalkResult::Advance;
 }
 
 void ASTDumper::dump(ModuleAST *node) {
     for (auto &func : node->getFunctions()) {
         dump(func.get());
     }
+    os.flush();
 }
 
-void ASTDumper::dump(VarDeclExprAST *node) {
-    INDENT();
-    std::cout << "VarDecl: " << node->getName() << loc(node) << std::endl;
-    dump(node->getExpr().get());
+WalkResult ASTDumper::enter(VarDeclExprAST *node) {
+    indent();
+    os << "VarDecl: " << node->getName();
+    if (node->getType().elementType) {
+        os << "<" << elementTypeName(*node->getType().elementType) << ">";
+    }
+    os << loc(node) << '\n';
+    return WalkResult::Advance;
 }
 
-void ASTDumper::dump(ReturnExprAST *node) {
-    INDENT();
-    std::cout << "Return:" << loc(node) << std::endl;
-    dump(node->getValue().get());
+WalkResult ASTDumper::enter(ReturnExprAST *node) {
+    indent();
+    os << "Return:" << loc(node) << '\n';
+    return WalkResult::Advance;
 }
 
-void ASTDumper::dump(LiteralExprAST *node) {
-    INDENT();
+WalkResult ASTDumper::enter(LiteralExprAST *node) {
+    indent();
     auto dims = node->getType();
-    std::cout << "Literal: " << "<" << dims.shape[0] << "," << dims.shape[1] << ">" << loc(node) << std::endl;
-    for (auto &value : node->getValues()) {
-        dump(value.get());
-    }
+    os << "Literal: " << "<" << dims.shape[0] << "," << dims.shape[1] << ">" << loc(node) << '\n';
+    return WalkResult::Advance;
+}
+
+WalkResult ASTDumper::enter(NumberExprAST *node) {
+    indent();
+    os << "Number: " << node->getVal() << loc(node) << '\n';
+    return WalkResult::Advance;
 }
 
-void ASTDumper::dump(NumberExprAST *node) {
-    INDENT();
-    std::cout << "Number: " << node->getVal() << loc(node) << std::endl;
+WalkResult ASTDumper::enter(StringExprAST *node) {
+    indent();
+    os << "String: \"" << node->getVal() << "\"" << loc(node) << '\n';
+    return WalkResult::Advance;
 }
 
 namespace toy {
 
 // Public API
-void dump(ModuleAST &module) { ASTDumper().dump(&module); }
+void dump(ModuleAST &module) { ASTDumper(std::cout).dump(&module); }
+
+void dump(ModuleAST &module, std::ostream &os) { ASTDumper(os).dump(&module); }
 
-} // namespace toy
\ No newline at end of file
+} // namespace toy
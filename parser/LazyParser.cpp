@@ -0,0 +1,90 @@
+#include "toy/LazyParser.hpp"
+#include "toy/ASTVisitor.hpp"
+#include "toy/Parser.hpp"
+
+#include <fstream>
+#include <unordered_map>
+
+using namespace toy;
+
+namespace {
+
+// Collects the callees of every call in a function body.
+struct CalleeCollector : ASTWalker<CalleeCollector> {
+    using ASTWalker::enter;
+
+    std::vector<std::string> *callees;
+
+    WalkResult enter(CallExprAST *call) {
+        callees->push_back(call->getCallee());
+        return WalkResult::Advance;
+    }
+};
+
+} // namespace
+
+namespace toy {
+
+std::unique_ptr<ModuleAST> parseReachable(const std::string &filename, std::ostream &errs,
+                                          std::vector<std::unique_ptr<PrototypeExprAST>> *unreachable) {
+    Lexer lexer(filename);
+    std::ifstream file(filename, std::ios::binary);
+    auto readSpan = [&](size_t begin, size_t end) {
+        std::string text(end - begin, '\0');
+        file.seekg(begin);
+        file.read(&text[0], text.size());
+        return text;
+    };
+
+    std::vector<Parser::FunctionDecl> decls;
+    if (!Parser(lexer, errs).parseDeclarations(decls)) {
+        return nullptr;
+    }
+    // Several definitions may share a name; all of them are parsed so that
+    // passes still see the redefinition.
+    std::unordered_map<std::string, std::vector<size_t>> byName;
+    for (size_t i = 0; i < decls.size(); i++) {
+        byName[decls[i].proto->getName()].push_back(i);
+    }
+
+    std::vector<std::unique_ptr<ExprASTList>> bodies(decls.size());
+    std::vector<std::string> worklist = {"main"};
+    std::vector<std::string> callees;
+    CalleeCollector collector;
+    collector.callees = &callees;
+    while (!worklist.empty()) {
+        auto it = byName.find(worklist.back());
+        worklist.pop_back();
+        if (it == byName.end()) {
+            continue; // a builtin, or unknown and left to the verifier
+        }
+        for (size_t i : it->second) {
+            auto &decl = decls[i];
+            Lexer bodyLexer(filename, readSpan(decl.bodyBegin, decl.bodyEnd), decl.bodyLoc.Line,
+                            decl.bodyLoc.Column);
+            bodies[i] = Parser(bodyLexer, errs).parseBody();
+            if (!bodies[i]) {
+                return nullptr;
+            }
+            callees.clear();
+            for (auto &expr : bodies[i]->getExprs()) {
+                collector.walk(expr.get());
+            }
+            worklist.insert(worklist.end(), callees.begin(), callees.end());
+        }
+        it->second.clear(); // parsed; later calls find nothing to do
+    }
+
+    std::vector<std::unique_ptr<FunctionExprAST>> functions;
+    for (size_t i = 0; i < decls.size(); i++) {
+        if (bodies[i]) {
+            functions.push_back(
+                std::make_unique<FunctionExprAST>(decls[i].loc, std::move(decls[i].proto), std::move(bodies[i])));
+        } else if (unreachable) {
+            unreachable->push_back(std::move(decls[i].proto));
+        }
+    }
+    return std::make_unique<ModuleAST>(std::move(functions));
+}
+
+} // namespace toy
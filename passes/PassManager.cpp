@@ -0,0 +1,44 @@
+#include "toy/PassManager.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace toy;
+
+namespace toy {
+
+bool PassManager::run(ModuleAST &module) {
+    for (auto &entry : passes) {
+        if (!timing) {
+            if (!entry.pass->run(module)) {
+                return false;
+            }
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        bool ok = entry.pass->run(module);
+        entry.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PassManager::printTimings(std::ostream &os) const {
+    double total = 0;
+    for (auto &entry : passes) {
+        total += entry.seconds;
+    }
+    char line[128];
+    os << "Pass execution timing report" << std::endl;
+    os << "  Wall time (s)   Pass" << std::endl;
+    for (auto &entry : passes) {
+        std::snprintf(line, sizeof(line), "  %13.6f   %s", entry.seconds, entry.pass->getName());
+        os << line << std::endl;
+    }
+    std::snprintf(line, sizeof(line), "  %13.6f   Total", total);
+    os << line << std::endl;
+}
+
+} // namespace toy
@@ -0,0 +1,110 @@
+#include "toy/ASTVisitor.hpp"
+#include "toy/PassManager.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace toy;
+
+namespace {
+
+struct Arity {
+    size_t min;
+    size_t max;
+};
+
+const std::unordered_map<std::string, Arity> Builtins = {
+    {"transpose", {1, 1}}, {"print", {1, 1}}, {"matmul", {2, 2}}, {"load", {3, 3}},
+    {"store", {2, 2}},     {"sum", {1, 2}},   {"mean", {1, 2}},   {"max", {1, 2}},
+};
+
+class Verifier : public Pass, public ASTWalker<Verifier> {
+public:
+    using ASTWalker::enter;
+    using ASTWalker::leave;
+
+    Verifier(std::ostream &errs) : errs(errs) {}
+
+    const char *getName() const override { return "verify"; }
+
+    bool run(ModuleAST &module) override {
+        ok = true;
+        functions.clear();
+        for (auto &func : module.getFunctions()) {
+            auto &proto = func->getProto();
+            if (!functions.emplace(proto->getName(), proto->getArgs().size()).second) {
+                error(proto->loc(), "redefinition of function '" + proto->getName() + "'");
+            }
+        }
+        walk(module);
+        return ok;
+    }
+
+    WalkResult enter(FunctionExprAST *) {
+        names.clear();
+        return WalkResult::Advance;
+    }
+
+    // Parameters are declarations, not uses.
+    WalkResult enter(PrototypeExprAST *proto) {
+        for (auto &arg : proto->getArgs()) {
+            if (!names.insert(arg->getName()).second) {
+                error(arg->loc(), "duplicate parameter '" + arg->getName() + "'");
+            }
+        }
+        return WalkResult::Skip;
+    }
+
+    // A declaration is in scope only after its initializer.
+    WalkResult leave(VarDeclExprAST *decl) {
+        if (!names.insert(decl->getName()).second) {
+            error(decl->loc(), "redefinition of '" + decl->getName() + "'");
+        }
+        return WalkResult::Advance;
+    }
+
+    WalkResult enter(VariableExprAST *var) {
+        if (!names.count(var->getName())) {
+            error(var->loc(), "unknown variable '" + var->getName() + "'");
+        }
+        return WalkResult::Advance;
+    }
+
+    WalkResult enter(CallExprAST *call) {
+        size_t args = call->getArgs().size();
+        auto func = functions.find(call->getCallee());
+        if (func != functions.end()) {
+            if (args != func->second) {
+                error(call->loc(), "'" + call->getCallee() + "' expects " + std::to_string(func->second) +
+                                       " arguments but got " + std::to_string(args));
+            }
+            return WalkResult::Advance;
+        }
+        auto builtin = Builtins.find(call->getCallee());
+        if (builtin == Builtins.end()) {
+            error(call->loc(), "unknown function '" + call->getCallee() + "'");
+        } else if (args < builtin->second.min || args > builtin->second.max) {
+            error(call->loc(), "wrong number of arguments to '" + call->getCallee() + "'");
+        }
+        return WalkResult::Advance;
+    }
+
+private:
+    void error(const Location &loc, const std::string &msg) {
+        errs << "Error: " << msg << " at line " << loc.Line << " column " << loc.Column << std::endl;
+        ok = false;
+    }
+
+    std::ostream &errs;
+    bool ok = true;
+    std::unordered_map<std::string, size_t> functions;
+    std::unordered_set<std::string> names;
+};
+
+} // namespace
+
+namespace toy {
+
+std::unique_ptr<Pass> createVerifierPass(std::ostream &errs) { return std::make_unique<Verifier>(errs); }
+
+} // namespace toy
@@ -0,0 +1,377 @@
+#include "toy/Interpreter.hpp"
+
+#include <cmath>
+#include <iostream>
+
+using namespace toy;
+
+namespace {
+
+std::string shapeStr(const Tensor &t) {
+    return "<" + std::to_string(t.rows()) + "," + std::to_string(t.cols()) + ">";
+}
+
+double scalarValue(const Tensor &t) {
+    return t.elementType() == ElementType::F32 ? t.data<float>()[0] : t.data<double>()[0];
+}
+
+// Collect the numbers of a (possibly nested) literal in row-major order.
+bool flatten(ExprAST *expr, std::vector<double> &values) {
+    // Literals nest as deeply as the parser accepts; walk them without recursion.
+    std::vector<ExprAST *> worklist = {expr};
+    while (!worklist.empty()) {
+        ExprAST *next = worklist.back();
+        worklist.pop_back();
+        if (auto num = dyn_cast<NumberExprAST>(next)) {
+            values.push_back(num->getVal());
+            continue;
+        }
+        auto lit = dyn_cast<LiteralExprAST>(next);
+        if (!lit) {
+            return false;
+        }
+        auto &children = lit->getValues();
+        for (size_t i = children.size(); i-- > 0;) {
+            worklist.push_back(children[i].get());
+        }
+    }
+    return true;
+}
+
+// True if `v` is a non-negative integer that a double represents exactly, so
+// it converts to size_t without rounding or undefined behavior.
+bool isDimension(double v) {
+    return v >= 0 && v <= 9007199254740992.0 && std::floor(v) == v;
+}
+
+// Operators, calls and literals are the expressions that do work worth profiling.
+bool isProfiledSite(ExprAST *expr) {
+    return dyn_cast<BinOpExprAST>(expr) || dyn_cast<CallExprAST>(expr) || dyn_cast<LiteralExprAST>(expr);
+}
+
+} // namespace
+
+namespace toy {
+
+Interpreter::Interpreter(ModuleAST &module, std::ostream &out, std::ostream &errs, const RunOptions &options)
+    : out(out), errs(errs), options(options) {
+    for (auto &func : module.getFunctions()) {
+        functions[func->getProto()->getName()] = func.get();
+    }
+}
+
+bool Interpreter::run() {
+    auto it = functions.find("main");
+    if (it == functions.end()) {
+        errs << "Error: no 'main' function" << std::endl;
+        return false;
+    }
+    auto res = callFunction(it->second, {}, it->second->getProto()->loc());
+    out.flush();
+    return res.has_value();
+}
+
+std::optional<Tensor> Interpreter::runtimeError(const Location &loc, const std::string &msg) {
+    errs << "Error: " << msg << " at line " << loc.Line << " column " << loc.Column << std::endl;
+    return std::nullopt;
+}
+
+Tensor Interpreter::account(Tensor result, std::initializer_list<const Tensor *> inputs) {
+    if (options.profiler) {
+        size_t moved = result.sizeInBytes();
+        for (auto input : inputs) {
+            moved += input->sizeInBytes();
+        }
+        options.profiler->addBytes(result.sizeInBytes(), moved);
+    }
+    return result;
+}
+
+Tensor Interpreter::convert(const Tensor &t, ElementType type) {
+    if (t.elementType() == type) {
+        return t;
+    }
+    return account(t.convert(type), {&t});
+}
+
+std::optional<Tensor> Interpreter::callFunction(FunctionExprAST *func, std::vector<Tensor> args, const Location &loc) {
+    auto &params = func->getProto()->getArgs();
+    if (params.size() != args.size()) {
+        return runtimeError(loc, "'" + func->getProto()->getName() + "' expects " + std::to_string(params.size()) +
+                                     " arguments but got " + std::to_string(args.size()));
+    }
+    if (callDepth >= MaxCallDepth) {
+        return runtimeError(loc, "call depth exceeds " + std::to_string(MaxCallDepth));
+    }
+    if (options.profiler) {
+        options.profiler->enterFunction(func, args);
+    }
+    Scope scope;
+    for (size_t i = 0; i < params.size(); i++) {
+        scope[params[i]->getName()] = std::move(args[i]);
+    }
+
+    callDepth++;
+    std::optional<Tensor> result = Tensor();
+    for (auto &expr : func->getBlock()->getExprs()) {
+        if (auto ret = dyn_cast<ReturnExprAST>(expr.get())) {
+            result = eval(ret->getValue().get(), scope);
+            break;
+        }
+        if (!eval(expr.get(), scope)) {
+            result = std::nullopt;
+            break;
+        }
+    }
+    callDepth--;
+    if (options.profiler) {
+        options.profiler->leave(result ? &*result : nullptr);
+    }
+    return result;
+}
+
+std::optional<Tensor> Interpreter::eval(ExprAST *expr, Scope &scope) {
+    if (exprDepth >= MaxExprDepth) {
+        return runtimeError(expr->loc(), "expression nesting exceeds " + std::to_string(MaxExprDepth));
+    }
+    exprDepth++;
+    std::optional<Tensor> result;
+    if (options.profiler && isProfiledSite(expr)) {
+        options.profiler->enter(expr);
+        result = evalKind(expr, scope);
+        options.profiler->leave(result ? &*result : nullptr);
+    } else {
+        result = evalKind(expr, scope);
+    }
+    exprDepth--;
+    return result;
+}
+
+std::optional<Tensor> Interpreter::evalKind(ExprAST *expr, Scope &scope) {
+    switch (expr->getKind()) {
+        case ExprAST::Expr_Var:
+            return eval(static_cast<VariableExprAST *>(expr), scope);
+        case ExprAST::Expr_VarDecl:
+            return eval(static_cast<VarDeclExprAST *>(expr), scope);
+        case ExprAST::Expr_BinOp:
+            return eval(static_cast<BinOpExprAST *>(expr), scope);
+        case ExprAST::Expr_Call:
+            return eval(static_cast<CallExprAST *>(expr), scope);
+        case ExprAST::Expr_Literal:
+            return eval(static_cast<LiteralExprAST *>(expr));
+        case ExprAST::Expr_Num:
+            return eval(static_cast<NumberExprAST *>(expr));
+        case ExprAST::Expr_String:
+            return runtimeError(expr->loc(), "string is only valid as a builtin argument");
+        default:
+            return runtimeError(expr->loc(), "unexpected expression");
+    }
+}
+
+std::optional<Tensor> Interpreter::eval(VariableExprAST *expr, Scope &scope) {
+    auto it = scope.find(expr->getName());
+    if (it == scope.end()) {
+        return runtimeError(expr->loc(), "unknown variable '" + expr->getName() + "'");
+    }
+    return it->second;
+}
+
+std::optional<Tensor> Interpreter::eval(VarDeclExprAST *expr, Scope &scope) {
+    if (scope.count(expr->getName())) {
+        return runtimeError(expr->loc(), "redefinition of '" + expr->getName() + "'");
+    }
+    auto value = eval(expr->getExpr().get(), scope);
+    if (!value) {
+        return std::nullopt;
+    }
+    auto &shape = expr->getType().shape;
+    if (!shape.empty()) {
+        if (shape[0] < 0 || shape[1] < 0 || size_t(shape[0]) * size_t(shape[1]) != value->size()) {
+            return runtimeError(expr->loc(), "cannot reshape " + shapeStr(*value) + " to <" +
+                                                 std::to_string(shape[0]) + "," + std::to_string(shape[1]) + ">");
+        }
+        value = value->reshape(shape[0], shape[1]);
+    }
+    if (expr->getType().elementType) {
+        value = convert(*value, *expr->getType().elementType);
+    }
+    scope[expr->getName()] = *value;
+    return value;
+}
+
+std::optional<Tensor> Interpreter::eval(BinOpExprAST *expr, Scope &scope) {
+    char op = expr->getOp();
+    if (op != '+' && op != '-' && op != '*' && op != '/') {
+        return runtimeError(expr->loc(), std::string("unsupported operator '") + op + "'");
+    }
+
+    // A number literal next to a tensor is a weakly typed scalar: it takes the
+    // tensor's element type and is never materialized.
+    auto lhsNum = dyn_cast<NumberExprAST>(expr->getLHS().get());
+    auto rhsNum = dyn_cast<NumberExprAST>(expr->getRHS().get());
+    if (lhsNum && !rhsNum) {
+        auto rhs = eval(expr->getRHS().get(), scope);
+        if (!rhs) {
+            return std::nullopt;
+        }
+        return account(elementwiseScalar(op, *rhs, lhsNum->getVal(), true), {&*rhs});
+    }
+    if (rhsNum && !lhsNum) {
+        auto lhs = eval(expr->getLHS().get(), scope);
+        if (!lhs) {
+            return std::nullopt;
+        }
+        return account(elementwiseScalar(op, *lhs, rhsNum->getVal(), false), {&*lhs});
+    }
+
+    auto lhs = eval(expr->getLHS().get(), scope);
+    if (!lhs) {
+        return std::nullopt;
+    }
+    auto rhs = eval(expr->getRHS().get(), scope);
+    if (!rhs) {
+        return std::nullopt;
+    }
+    ElementType type = promote(lhs->elementType(), rhs->elementType());
+    if (lhs->rows() == rhs->rows() && lhs->cols() == rhs->cols()) {
+        return account(elementwise(op, convert(*lhs, type), convert(*rhs, type)), {&*lhs, &*rhs});
+    }
+    // Any other <1,1> operand, e.g. the result of sum(), broadcasts too.
+    if (lhs->size() == 1 && lhs->rows() == 1) {
+        return account(elementwiseScalar(op, convert(*rhs, type), scalarValue(*lhs), true), {&*lhs, &*rhs});
+    }
+    if (rhs->size() == 1 && rhs->rows() == 1) {
+        return account(elementwiseScalar(op, convert(*lhs, type), scalarValue(*rhs), false), {&*lhs, &*rhs});
+    }
+    return runtimeError(expr->loc(), "shape mismatch " + shapeStr(*lhs) + " " + op + " " + shapeStr(*rhs));
+}
+
+std::optional<Tensor> Interpreter::eval(CallExprAST *expr, Scope &scope) {
+    auto it = functions.find(expr->getCallee());
+    if (it == functions.end()) {
+        return evalBuiltin(expr, scope);
+    }
+    std::vector<Tensor> args;
+    for (auto &arg : expr->getArgs()) {
+        auto value = eval(arg.get(), scope);
+        if (!value) {
+            return std::nullopt;
+        }
+        args.push_back(std::move(*value));
+    }
+    return callFunction(it->second, std::move(args), expr->loc());
+}
+
+std::optional<Tensor> Interpreter::eval(LiteralExprAST *expr) {
+    std::vector<double> values;
+    if (!flatten(expr, values)) {
+        return runtimeError(expr->loc(), "tensor literal may only contain numbers");
+    }
+    auto &shape = expr->getType().shape;
+    size_t rows = shape[0];
+    size_t cols = shape[1];
+    if (rows * cols != values.size()) {
+        return runtimeError(expr->loc(), "tensor literal of rank > 2 is not supported");
+    }
+    Tensor t = Tensor::create(rows, cols);
+    std::copy(values.begin(), values.end(), t.mutableData<double>());
+    return convert(account(t, {}), options.defaultType);
+}
+
+std::optional<Tensor> Interpreter::eval(NumberExprAST *expr) {
+    Tensor t = Tensor::create(1, 1, options.defaultType);
+    if (options.defaultType == ElementType::F32) {
+        t.mutableData<float>()[0] = expr->getVal();
+    } else {
+        t.mutableData<double>()[0] = expr->getVal();
+    }
+    return t;
+}
+
+std::optional<Tensor> Interpreter::evalBuiltin(CallExprAST *expr, Scope &scope) {
+    const std::string &callee = expr->getCallee();
+    auto &args = expr->getArgs();
+
+    if (callee == "load") {
+        auto path = args.size() == 3 ? dyn_cast<StringExprAST>(args[0].get()) : nullptr;
+        auto rows = args.size() == 3 ? dyn_cast<NumberExprAST>(args[1].get()) : nullptr;
+        auto cols = args.size() == 3 ? dyn_cast<NumberExprAST>(args[2].get()) : nullptr;
+        if (!path || !rows || !cols) {
+            return runtimeError(expr->loc(), "expected load(\"path\", rows, cols)");
+        }
+        if (!isDimension(rows->getVal()) || !isDimension(cols->getVal())) {
+            return runtimeError(expr->loc(), "load dimensions must be non-negative integers");
+        }
+        Tensor t = Tensor::load(path->getVal(), rows->getVal(), cols->getVal(), errs);
+        if (t.empty()) {
+            return runtimeError(expr->loc(), "load failed");
+        }
+        return t;
+    }
+
+    if (callee == "store") {
+        auto path = args.size() == 2 ? dyn_cast<StringExprAST>(args[1].get()) : nullptr;
+        if (!path) {
+            return runtimeError(expr->loc(), "expected store(value, \"path\")");
+        }
+        auto value = eval(args[0].get(), scope);
+        if (!value) {
+            return std::nullopt;
+        }
+        if (!value->store(path->getVal(), errs)) {
+            return runtimeError(expr->loc(), "store failed");
+        }
+        return account(Tensor(), {&*value});
+    }
+
+    if (callee == "sum" || callee == "mean" || callee == "max") {
+        auto axis = args.size() == 2 ? dyn_cast<NumberExprAST>(args[1].get()) : nullptr;
+        if ((args.size() != 1 && args.size() != 2) || (args.size() == 2 && !axis) ||
+            (axis && axis->getVal() != 0 && axis->getVal() != 1)) {
+            return runtimeError(expr->loc(), "expected " + callee + "(value) or " + callee + "(value, 0|1)");
+        }
+        auto value = eval(args[0].get(), scope);
+        if (!value) {
+            return std::nullopt;
+        }
+        ReduceKind kind = callee == "sum" ? ReduceKind::Sum : callee == "mean" ? ReduceKind::Mean : ReduceKind::Max;
+        return account(reduce(kind, *value, axis ? int(axis->getVal()) : -1, options.threads), {&*value});
+    }
+
+    if (callee == "matmul") {
+        if (args.size() != 2) {
+            return runtimeError(expr->loc(), "'matmul' expects 2 arguments");
+        }
+        auto lhs = eval(args[0].get(), scope);
+        if (!lhs) {
+            return std::nullopt;
+        }
+        auto rhs = eval(args[1].get(), scope);
+        if (!rhs) {
+            return std::nullopt;
+        }
+        if (lhs->cols() != rhs->rows()) {
+            return runtimeError(expr->loc(), "shape mismatch in matmul(" + shapeStr(*lhs) + ", " + shapeStr(*rhs) + ")");
+        }
+        ElementType type = promote(lhs->elementType(), rhs->elementType());
+        return account(matmul(convert(*lhs, type), convert(*rhs, type), options.threads), {&*lhs, &*rhs});
+    }
+
+    if (callee != "transpose" && callee != "print") {
+        return runtimeError(expr->loc(), "unknown function '" + callee + "'");
+    }
+    if (args.size() != 1) {
+        return runtimeError(expr->loc(), "'" + callee + "' expects 1 argument");
+    }
+    auto value = eval(args[0].get(), scope);
+    if (!value) {
+        return std::nullopt;
+    }
+    if (callee == "transpose") {
+        return account(transpose(*value), {&*value});
+    }
+    printTensor(*value, out, options.print);
+    return account(Tensor(), {&*value});
+}
+
+} // namespace toy
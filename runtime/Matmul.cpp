@@ -0,0 +1,176 @@
+#include "toy/Tensor.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace toy;
+
+namespace {
+
+// Blocking parameters in the style of the Goto/BLIS GEMM. An MR x NR block of
+// C lives in registers for the micro-kernel; a KC x NR panel of B stays in L1,
+// an MC x KC block of A in L2 and a KC x NC block of B in L3.
+template <typename T>
+struct GemmBlocking;
+
+template <>
+struct GemmBlocking<double> {
+    static constexpr size_t MR = 4;
+    static constexpr size_t NR = 8;
+    static constexpr size_t KC = 256;
+    static constexpr size_t MC = 96;
+    static constexpr size_t NC = 2048;
+};
+
+template <>
+struct GemmBlocking<float> {
+    static constexpr size_t MR = 4;
+    static constexpr size_t NR = 16;
+    static constexpr size_t KC = 256;
+    static constexpr size_t MC = 96;
+    static constexpr size_t NC = 4096;
+};
+
+// Products smaller than this many multiply-adds are not worth extra threads.
+constexpr size_t ParallelFlops = size_t(1) << 22;
+
+constexpr std::align_val_t PackAlignment{64};
+
+template <typename T>
+struct PackBuffer {
+    PackBuffer(size_t n) : data(static_cast<T *>(::operator new(n * sizeof(T), PackAlignment))) {}
+    ~PackBuffer() { ::operator delete(data, PackAlignment); }
+    PackBuffer(const PackBuffer &) = delete;
+    PackBuffer &operator=(const PackBuffer &) = delete;
+
+    T *data;
+};
+
+// Pack an mc x kc block of A (row-major, leading dimension lda) into MR-row
+// panels, each stored k-major, zero-padding the last panel.
+template <typename T>
+void packA(const T *a, size_t lda, size_t mc, size_t kc, T *out) {
+    constexpr size_t MR = GemmBlocking<T>::MR;
+    for (size_t i = 0; i < mc; i += MR) {
+        size_t mr = std::min(MR, mc - i);
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t r = 0; r < MR; r++) {
+                *out++ = r < mr ? a[(i + r) * lda + p] : T(0);
+            }
+        }
+    }
+}
+
+// Pack a kc x nc block of B (row-major, leading dimension ldb) into NR-column
+// panels, each stored k-major, zero-padding the last panel.
+template <typename T>
+void packB(const T *b, size_t ldb, size_t kc, size_t nc, T *out) {
+    constexpr size_t NR = GemmBlocking<T>::NR;
+    for (size_t j = 0; j < nc; j += NR) {
+        size_t nr = std::min(NR, nc - j);
+        for (size_t p = 0; p < kc; p++) {
+            const T *row = b + p * ldb + j;
+            for (size_t c = 0; c < NR; c++) {
+                *out++ = c < nr ? row[c] : T(0);
+            }
+        }
+    }
+}
+
+// C[0:mr, 0:nr] (+)= Ap * Bp over kc. The accumulator has a fixed MR x NR
+// shape so that the compiler keeps it in vector registers.
+template <typename T>
+void microKernel(size_t kc, const T *ap, const T *bp, T *c, size_t ldc, size_t mr, size_t nr, bool accumulate) {
+    constexpr size_t MR = GemmBlocking<T>::MR;
+    constexpr size_t NR = GemmBlocking<T>::NR;
+    T acc[MR][NR] = {};
+    for (size_t p = 0; p < kc; p++) {
+        for (size_t i = 0; i < MR; i++) {
+            T a = ap[p * MR + i];
+            for (size_t j = 0; j < NR; j++) {
+                acc[i][j] += a * bp[p * NR + j];
+            }
+        }
+    }
+    for (size_t i = 0; i < mr; i++) {
+        T *row = c + i * ldc;
+        for (size_t j = 0; j < nr; j++) {
+            row[j] = accumulate ? row[j] + acc[i][j] : acc[i][j];
+        }
+    }
+}
+
+// Compute rows [rowBegin, rowEnd) of C = A * B.
+template <typename T>
+void gemmRows(const T *a, const T *b, T *c, size_t k, size_t n, size_t rowBegin, size_t rowEnd) {
+    using B = GemmBlocking<T>;
+    PackBuffer<T> packedA(B::MC * B::KC);
+    PackBuffer<T> packedB(B::KC * ((std::min(B::NC, n) + B::NR - 1) / B::NR * B::NR));
+    for (size_t jc = 0; jc < n; jc += B::NC) {
+        size_t nc = std::min(B::NC, n - jc);
+        for (size_t pc = 0; pc < k; pc += B::KC) {
+            size_t kc = std::min(B::KC, k - pc);
+            packB(b + pc * n + jc, n, kc, nc, packedB.data);
+            for (size_t ic = rowBegin; ic < rowEnd; ic += B::MC) {
+                size_t mc = std::min(B::MC, rowEnd - ic);
+                packA(a + ic * k + pc, k, mc, kc, packedA.data);
+                for (size_t jr = 0; jr < nc; jr += B::NR) {
+                    for (size_t ir = 0; ir < mc; ir += B::MR) {
+                        microKernel(kc, packedA.data + ir * kc, packedB.data + jr * kc, c + (ic + ir) * n + jc + jr,
+                                    n, std::min(B::MR, mc - ir), std::min(B::NR, nc - jr), pc > 0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void gemm(const T *a, const T *b, T *c, size_t m, size_t k, size_t n, unsigned threads) {
+    if (k == 0) {
+        std::fill(c, c + m * n, T(0));
+        return;
+    }
+    constexpr size_t MR = GemmBlocking<T>::MR;
+    size_t panels = (m + MR - 1) / MR;
+    if (threads <= 1 || m * n * k < ParallelFlops || panels < 2) {
+        gemmRows(a, b, c, k, n, 0, m);
+        return;
+    }
+    // Split C into contiguous row ranges aligned to the micro-kernel height;
+    // each thread packs the B blocks it needs itself.
+    threads = std::min<size_t>(threads, panels);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        size_t rowBegin = std::min(m, panels * t / threads * MR);
+        size_t rowEnd = std::min(m, panels * (t + 1) / threads * MR);
+        workers.emplace_back([=]() { gemmRows(a, b, c, k, n, rowBegin, rowEnd); });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+namespace toy {
+
+Tensor matmul(const Tensor &lhs, const Tensor &rhs, unsigned threads) {
+    if (!threads) {
+        threads = std::thread::hardware_concurrency();
+    }
+    Tensor res = Tensor::create(lhs.rows(), rhs.cols(), lhs.elementType());
+    if (lhs.elementType() == ElementType::F32) {
+        gemm(lhs.data<float>(), rhs.data<float>(), res.mutableData<float>(), lhs.rows(), lhs.cols(), rhs.cols(),
+             threads);
+    } else {
+        gemm(lhs.data<double>(), rhs.data<double>(), res.mutableData<double>(), lhs.rows(), lhs.cols(), rhs.cols(),
+             threads);
+    }
+    return res;
+}
+
+} // namespace toy
@@ -0,0 +1,156 @@
+#include "toy/Print.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace toy;
+
+namespace {
+
+// Serial output is written to the stream whenever the buffer passes this size.
+constexpr size_t FlushThreshold = 1 << 20;
+// Tensors smaller than this are not worth spreading over threads.
+constexpr size_t ParallelThreshold = 1 << 18;
+// Elements formatted by one parallel task.
+constexpr size_t TaskElements = 1 << 16;
+// Enough for any shortest round-trip double plus its separator.
+constexpr size_t MaxElementChars = 32;
+// Formatted tasks buffered ahead of the writer, whatever the thread count;
+// each holds up to TaskElements * MaxElementChars (2 MiB).
+constexpr size_t MaxBufferedTasks = 16;
+
+// Append elements [begin, end) of `t` to `buf`, each followed by ' ', or by
+// '\n' when it ends a row. Floats are formatted as the shortest float, not
+// as the double they widen to.
+template <typename T>
+void formatElements(const Tensor &t, size_t begin, size_t end, std::string &buf) {
+    const T *data = t.data<T>();
+    size_t cols = t.cols();
+    size_t pos = buf.size();
+    buf.resize(pos + (end - begin) * MaxElementChars);
+    char *out = &buf[pos];
+    size_t col = begin % cols;
+    for (size_t i = begin; i < end; i++) {
+        out = std::to_chars(out, out + MaxElementChars, data[i]).ptr;
+        if (++col == cols) {
+            *out++ = '\n';
+            col = 0;
+        } else {
+            *out++ = ' ';
+        }
+    }
+    buf.resize(out - buf.data());
+}
+
+void formatElements(const Tensor &t, size_t begin, size_t end, std::string &buf) {
+    if (t.elementType() == ElementType::F32) {
+        formatElements<float>(t, begin, end, buf);
+    } else {
+        formatElements<double>(t, begin, end, buf);
+    }
+}
+
+void printText(const Tensor &t, std::ostream &out) {
+    std::string buf;
+    buf.reserve(FlushThreshold + TaskElements * MaxElementChars);
+    for (size_t begin = 0; begin < t.size(); begin += TaskElements) {
+        formatElements(t, begin, std::min(begin + TaskElements, t.size()), buf);
+        if (buf.size() >= FlushThreshold) {
+            out.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    }
+    out.write(buf.data(), buf.size());
+}
+
+// Format tasks on a pool of worker threads while the calling thread writes
+// them in order. Task k is formatted into slot k % slots once task k - slots
+// has been written, so memory stays bounded by the slots rather than the
+// tensor size or the thread count.
+void printTextParallel(const Tensor &t, std::ostream &out, unsigned threads) {
+    size_t tasks = (t.size() + TaskElements - 1) / TaskElements;
+    size_t slots = std::min({size_t(threads) * 4, MaxBufferedTasks, tasks});
+    std::vector<std::string> chunks(slots);
+    std::vector<char> ready(slots, false);
+    size_t nextTask = 0;
+    size_t written = 0;
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    auto work = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [&]() { return nextTask == tasks || nextTask < written + slots; });
+            if (nextTask == tasks) {
+                return;
+            }
+            size_t k = nextTask++;
+            lock.unlock();
+            std::string &chunk = chunks[k % slots];
+            chunk.clear();
+            size_t begin = k * TaskElements;
+            formatElements(t, begin, std::min(begin + TaskElements, t.size()), chunk);
+            lock.lock();
+            ready[k % slots] = true;
+            changed.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < std::min(size_t(threads), slots); w++) {
+        workers.emplace_back(work);
+    }
+    for (size_t k = 0; k < tasks; k++) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return bool(ready[k % slots]); });
+        }
+        out.write(chunks[k % slots].data(), chunks[k % slots].size());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready[k % slots] = false;
+            written++;
+        }
+        changed.notify_all();
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void printBinary(const Tensor &t, std::ostream &out) {
+    TensorFileHeader header{};
+    std::memcpy(header.magic, TensorFileMagic, sizeof(TensorFileMagic));
+    header.rows = t.rows();
+    header.cols = t.cols();
+    header.elementType = uint64_t(t.elementType());
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(static_cast<const char *>(t.rawData()), t.sizeInBytes());
+}
+
+} // namespace
+
+namespace toy {
+
+void printTensor(const Tensor &t, std::ostream &out, const PrintOptions &options) {
+    if (options.binary) {
+        printBinary(t, out);
+        return;
+    }
+    if (t.size() == 0) {
+        return;
+    }
+    unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if (threads > 1 && t.size() >= ParallelThreshold) {
+        printTextParallel(t, out, threads);
+    } else {
+        printText(t, out);
+    }
+}
+
+} // namespace toy
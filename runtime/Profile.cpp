@@ -0,0 +1,182 @@
+#include "toy/Profile.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+using namespace toy;
+
+namespace {
+
+std::string shapeName(size_t rows, size_t cols, ElementType type) {
+    return std::to_string(rows) + "x" + std::to_string(cols) + elementTypeName(type);
+}
+
+std::string siteName(ExprAST *expr) {
+    std::string name;
+    if (auto binOp = dyn_cast<BinOpExprAST>(expr)) {
+        name = std::string(1, binOp->getOp());
+    } else if (auto call = dyn_cast<CallExprAST>(expr)) {
+        name = call->getCallee();
+    } else if (dyn_cast<LiteralExprAST>(expr)) {
+        name = "literal";
+    } else {
+        name = "expr";
+    }
+    const Location &loc = expr->loc();
+    return name + "@" + std::to_string(loc.Line) + ":" + std::to_string(loc.Column);
+}
+
+} // namespace
+
+namespace toy {
+
+Profiler::Profiler() { nodes.push_back({None, None}); }
+
+void Profiler::enter(ExprAST *expr) {
+    auto it = exprSites.find(expr);
+    if (it == exprSites.end()) {
+        it = exprSites.emplace(expr, sites.size()).first;
+        sites.push_back({siteName(expr), false});
+    }
+    push(it->second, false);
+}
+
+void Profiler::enterFunction(FunctionExprAST *func, const std::vector<Tensor> &args) {
+    argShapes.clear();
+    for (auto &arg : args) {
+        argShapes.push_back({arg.rows(), arg.cols(), arg.elementType()});
+    }
+    auto &specializations = functionSites[func];
+    for (auto &specialization : specializations) {
+        if (specialization.first == argShapes) {
+            push(specialization.second, true);
+            return;
+        }
+    }
+    std::string name = func->getProto()->getName() + "(";
+    for (size_t i = 0; i < argShapes.size(); i++) {
+        name += (i ? "," : "") + shapeName(argShapes[i].rows, argShapes[i].cols, argShapes[i].type);
+    }
+    name += ")";
+    specializations.push_back({argShapes, sites.size()});
+    sites.push_back({name, true});
+    push(specializations.back().second, true);
+}
+
+void Profiler::push(size_t site, bool function) {
+    size_t parent = frames.empty() ? 0 : frames.back().node;
+    auto child = nodes[parent].children.find(site);
+    size_t node;
+    if (child != nodes[parent].children.end()) {
+        node = child->second;
+    } else {
+        node = nodes.size();
+        nodes[parent].children.emplace(site, node);
+        nodes.push_back({site, parent});
+    }
+    size_t enclosing = function ? frames.size() : frames.empty() ? None : frames.back().function;
+    sites[site].active++;
+    frames.push_back({site, node, enclosing, Clock::now()});
+}
+
+void Profiler::leave(const Tensor *result) {
+    Frame frame = frames.back();
+    frames.pop_back();
+    double seconds = std::chrono::duration<double>(Clock::now() - frame.start).count();
+
+    Site &site = sites[frame.site];
+    site.calls++;
+    site.selfSeconds += seconds - (site.function ? frame.nestedCallSeconds : frame.nestedSeconds);
+    if (--site.active == 0) {
+        site.totalSeconds += seconds;
+    }
+    nodes[frame.node].selfSeconds += seconds - frame.nestedSeconds;
+    if (result && !result->empty() && !site.moreShapes) {
+        Shape shape{result->rows(), result->cols(), result->elementType()};
+        bool seen = std::find(site.shapes.begin(), site.shapes.end(), shape) != site.shapes.end();
+        if (!seen && site.shapes.size() < MaxShapes) {
+            site.shapes.push_back(shape);
+        } else if (!seen) {
+            site.moreShapes = true;
+        }
+    }
+
+    if (!frames.empty()) {
+        frames.back().nestedSeconds += seconds;
+        if (site.function && frames.back().function != None) {
+            frames[frames.back().function].nestedCallSeconds += seconds;
+        }
+    }
+}
+
+void Profiler::addBytes(size_t allocated, size_t moved) {
+    Frame &frame = frames.back();
+    sites[frame.site].allocated += allocated;
+    sites[frame.site].moved += moved;
+    if (frame.function != None && frame.function != frames.size() - 1) {
+        Site &function = sites[frames[frame.function].site];
+        function.allocated += allocated;
+        function.moved += moved;
+    }
+}
+
+void Profiler::writeTable(std::ostream &os, bool functions, size_t top) const {
+    std::vector<const Site *> order;
+    for (auto &site : sites) {
+        if (site.function == functions) {
+            order.push_back(&site);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const Site *a, const Site *b) { return a->selfSeconds > b->selfSeconds; });
+
+    char line[160];
+    os << (functions ? "Functions" : "Operations") << " (" << std::min(top, order.size()) << " of "
+       << order.size() << " by self time)" << std::endl;
+    os << "       Calls     Self ms    Total ms     Alloc bytes     Moved bytes   Site" << std::endl;
+    for (size_t i = 0; i < order.size() && i < top; i++) {
+        const Site &site = *order[i];
+        std::snprintf(line, sizeof(line), "  %10" PRIu64 "  %10.3f  %10.3f  %14" PRIu64 "  %14" PRIu64 "   ",
+                      site.calls, site.selfSeconds * 1e3, site.totalSeconds * 1e3, site.allocated, site.moved);
+        os << line << site.name;
+        if (!site.function && !site.shapes.empty()) {
+            os << " ->";
+            for (auto &shape : site.shapes) {
+                os << " " << shapeName(shape.rows, shape.cols, shape.type);
+            }
+            if (site.moreShapes) {
+                os << " ...";
+            }
+        }
+        os << std::endl;
+    }
+}
+
+void Profiler::report(std::ostream &os, size_t top) const {
+    writeTable(os, true, top);
+    os << std::endl;
+    writeTable(os, false, top);
+}
+
+void Profiler::writeCollapsed(std::ostream &os) const {
+    std::vector<size_t> path;
+    for (size_t i = 1; i < nodes.size(); i++) {
+        long long nanos = std::llround(nodes[i].selfSeconds * 1e9);
+        if (nanos <= 0) {
+            continue;
+        }
+        path.clear();
+        for (size_t n = i; n != 0; n = nodes[n].parent) {
+            path.push_back(nodes[n].site);
+        }
+        for (size_t j = path.size(); j-- > 0;) {
+            os << sites[path[j]].name << (j ? ";" : " ");
+        }
+        os << nanos << '\n';
+    }
+    os.flush();
+}
+
+} // namespace toy
@@ -0,0 +1,181 @@
+#include "toy/Tensor.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <vector>
+
+using namespace toy;
+
+namespace {
+
+// Independent accumulators per chunk; enough to hide add latency and fill a
+// few vector registers.
+constexpr size_t Lanes = 16;
+// Elements reduced sequentially before partial results are combined. The
+// chunking depends only on the input size, so results do not depend on the
+// number of threads.
+constexpr size_t ChunkElements = 1 << 14;
+// Reductions over fewer elements than this stay on one thread.
+constexpr size_t ParallelElements = 1 << 20;
+
+template <typename T>
+struct SumOp {
+    static T identity() { return T(0); }
+    static T combine(T a, T b) { return a + b; }
+};
+
+template <typename T>
+struct MaxOp {
+    static T identity() { return -std::numeric_limits<T>::infinity(); }
+    // A NaN in either operand propagates, as in the element-wise operators.
+    static T combine(T a, T b) { return b > a || b != b ? b : a; }
+};
+
+// Combine `values` pairwise, in a fixed order. Destroys `values`.
+template <typename T, typename Op>
+T combineTree(std::vector<T> &values) {
+    if (values.empty()) {
+        return Op::identity();
+    }
+    size_t n = values.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        for (size_t i = 0; i < half; i++) {
+            values[i] = Op::combine(values[2 * i], values[2 * i + 1]);
+        }
+        if (n % 2) {
+            values[half] = values[n - 1];
+        }
+        n = half + n % 2;
+    }
+    return values[0];
+}
+
+template <typename T, typename Op>
+T reduceChunk(const T *data, size_t n) {
+    T acc[Lanes];
+    std::fill(acc, acc + Lanes, Op::identity());
+    size_t i = 0;
+    for (; i + Lanes <= n; i += Lanes) {
+        for (size_t l = 0; l < Lanes; l++) {
+            acc[l] = Op::combine(acc[l], data[i + l]);
+        }
+    }
+    for (size_t l = 0; i < n; i++, l++) {
+        acc[l] = Op::combine(acc[l], data[i]);
+    }
+    for (size_t width = Lanes / 2; width > 0; width /= 2) {
+        for (size_t l = 0; l < width; l++) {
+            acc[l] = Op::combine(acc[l], acc[l + width]);
+        }
+    }
+    return acc[0];
+}
+
+// Run body(begin, end) over [0, n) split into `threads` contiguous ranges.
+template <typename Body>
+void parallelFor(size_t n, unsigned threads, Body body) {
+    if (threads <= 1 || n < 2) {
+        body(0, n);
+        return;
+    }
+    threads = std::min<size_t>(threads, n);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        size_t begin = n * t / threads;
+        size_t end = n * (t + 1) / threads;
+        workers.emplace_back([=]() { body(begin, end); });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+template <typename T, typename Op>
+T reduceAll(const T *data, size_t n, unsigned threads) {
+    size_t chunks = (n + ChunkElements - 1) / ChunkElements;
+    std::vector<T> partials(chunks);
+    parallelFor(chunks, n >= ParallelElements ? threads : 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t first = c * ChunkElements;
+            partials[c] = reduceChunk<T, Op>(data + first, std::min(ChunkElements, n - first));
+        }
+    });
+    return combineTree<T, Op>(partials);
+}
+
+// Reduce over rows: out[c] = op over r of data[r][c]. Rows are streamed in
+// order, so each column sees the same sequence of operations.
+template <typename T, typename Op>
+void reduceColumns(const T *data, size_t rows, size_t cols, T *out, unsigned threads) {
+    parallelFor(cols, rows * cols >= ParallelElements ? threads : 1, [&](size_t begin, size_t end) {
+        std::fill(out + begin, out + end, Op::identity());
+        for (size_t r = 0; r < rows; r++) {
+            const T *row = data + r * cols;
+            for (size_t c = begin; c < end; c++) {
+                out[c] = Op::combine(out[c], row[c]);
+            }
+        }
+    });
+}
+
+// Reduce each row to one element.
+template <typename T, typename Op>
+void reduceRows(const T *data, size_t rows, size_t cols, T *out, unsigned threads) {
+    parallelFor(rows, rows * cols >= ParallelElements ? threads : 1, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+            out[r] = reduceAll<T, Op>(data + r * cols, cols, 1);
+        }
+    });
+}
+
+template <typename T, typename Op>
+Tensor reduceWith(const Tensor &t, int axis, unsigned threads) {
+    const T *data = t.data<T>();
+    if (axis == 0) {
+        Tensor res = Tensor::create(1, t.cols(), t.elementType());
+        reduceColumns<T, Op>(data, t.rows(), t.cols(), res.mutableData<T>(), threads);
+        return res;
+    }
+    if (axis == 1) {
+        Tensor res = Tensor::create(t.rows(), 1, t.elementType());
+        reduceRows<T, Op>(data, t.rows(), t.cols(), res.mutableData<T>(), threads);
+        return res;
+    }
+    Tensor res = Tensor::create(1, 1, t.elementType());
+    res.mutableData<T>()[0] = reduceAll<T, Op>(data, t.size(), threads);
+    return res;
+}
+
+template <typename T>
+Tensor reduceTyped(ReduceKind kind, const Tensor &t, int axis, unsigned threads) {
+    if (kind == ReduceKind::Max) {
+        return reduceWith<T, MaxOp<T>>(t, axis, threads);
+    }
+    Tensor res = reduceWith<T, SumOp<T>>(t, axis, threads);
+    if (kind == ReduceKind::Mean) {
+        T count = axis == 0 ? t.rows() : axis == 1 ? t.cols() : t.size();
+        T *out = res.mutableData<T>();
+        for (size_t i = 0; i < res.size(); i++) {
+            out[i] /= count;
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+namespace toy {
+
+Tensor reduce(ReduceKind kind, const Tensor &t, int axis, unsigned threads) {
+    if (!threads) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (t.elementType() == ElementType::F32) {
+        return reduceTyped<float>(kind, t, axis, threads);
+    }
+    return reduceTyped<double>(kind, t, axis, threads);
+}
+
+} // namespace toy
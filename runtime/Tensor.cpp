@@ -0,0 +1,294 @@
+#include "toy/Tensor.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace toy;
+
+static_assert(sizeof(TensorFileHeader) == 32, "tensor data must stay 32-byte aligned");
+
+namespace {
+
+constexpr bool isLittleEndian() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool writeAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Sets `bytes` to the storage size of a <rows,cols> tensor, or returns false
+// if the element count or byte count overflows size_t.
+bool byteSize(size_t rows, size_t cols, ElementType type, size_t &bytes) {
+    return !__builtin_mul_overflow(rows, cols, &bytes) && !__builtin_mul_overflow(bytes, elementSize(type), &bytes);
+}
+
+// Storage is cache-line aligned so kernels can use aligned vector loads.
+constexpr std::align_val_t StorageAlignment{64};
+
+template <typename From, typename To>
+void convertElements(const From *in, To *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = static_cast<To>(in[i]);
+    }
+}
+
+template <typename T>
+void transposeElements(const T *in, T *out, size_t rows, size_t cols) {
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            out[j * rows + i] = in[i * cols + j];
+        }
+    }
+}
+
+template <typename T>
+void elementwiseElements(char op, const T *a, const T *b, T *out, size_t n) {
+    switch (op) {
+        case '+':
+            for (size_t i = 0; i < n; i++) out[i] = a[i] + b[i];
+            break;
+        case '-':
+            for (size_t i = 0; i < n; i++) out[i] = a[i] - b[i];
+            break;
+        case '*':
+            for (size_t i = 0; i < n; i++) out[i] = a[i] * b[i];
+            break;
+        case '/':
+            for (size_t i = 0; i < n; i++) out[i] = a[i] / b[i];
+            break;
+    }
+}
+
+template <typename T>
+void elementwiseScalarElements(char op, const T *a, T scalar, bool scalarIsLHS, T *out, size_t n) {
+    switch (op) {
+        case '+':
+            for (size_t i = 0; i < n; i++) out[i] = a[i] + scalar;
+            break;
+        case '-':
+            if (scalarIsLHS) {
+                for (size_t i = 0; i < n; i++) out[i] = scalar - a[i];
+            } else {
+                for (size_t i = 0; i < n; i++) out[i] = a[i] - scalar;
+            }
+            break;
+        case '*':
+            for (size_t i = 0; i < n; i++) out[i] = a[i] * scalar;
+            break;
+        case '/':
+            if (scalarIsLHS) {
+                for (size_t i = 0; i < n; i++) out[i] = scalar / a[i];
+            } else {
+                for (size_t i = 0; i < n; i++) out[i] = a[i] / scalar;
+            }
+            break;
+    }
+}
+
+} // namespace
+
+namespace toy {
+
+Tensor Tensor::create(size_t rows, size_t cols, ElementType type) {
+    Tensor t;
+    t.Rows = rows;
+    t.Cols = cols;
+    t.Type = type;
+    size_t bytes;
+    if (!byteSize(rows, cols, type, bytes)) {
+        throw std::length_error("tensor <" + std::to_string(rows) + "," + std::to_string(cols) + "> is too large");
+    }
+    void *data = ::operator new(bytes ? bytes : 1, StorageAlignment);
+    t.Storage = std::shared_ptr<void>(data, [](void *p) { ::operator delete(p, StorageAlignment); });
+    t.Data = data;
+    return t;
+}
+
+Tensor Tensor::load(const std::string &path, size_t rows, size_t cols, std::ostream &errs) {
+    if (!isLittleEndian()) {
+        errs << "Error: load is only supported on little-endian hosts" << std::endl;
+        return Tensor();
+    }
+    if (rows == 0 || cols == 0) {
+        errs << "Error: cannot load an empty tensor from " << path << std::endl;
+        return Tensor();
+    }
+    size_t maxDataSize;
+    if (!byteSize(rows, cols, ElementType::F64, maxDataSize)) {
+        errs << "Error: cannot load <" << rows << "," << cols << "> from " << path << ": tensor is too large"
+             << std::endl;
+        return Tensor();
+    }
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errs << "Error opening file: " << path << ": " << std::strerror(errno) << std::endl;
+        return Tensor();
+    }
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+        errs << "Error: cannot stat " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return Tensor();
+    }
+    size_t fileSize = st.st_size;
+    if (fileSize == 0) {
+        errs << "Error: " << path << " is empty" << std::endl;
+        ::close(fd);
+        return Tensor();
+    }
+
+    void *base = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        errs << "Error: cannot map " << path << ": " << std::strerror(errno) << std::endl;
+        return Tensor();
+    }
+    std::shared_ptr<const void> storage(base, [fileSize](const void *p) { ::munmap(const_cast<void *>(p), fileSize); });
+
+    size_t offset = 0;
+    ElementType type = ElementType::F64;
+    auto header = static_cast<const TensorFileHeader *>(base);
+    if (fileSize >= sizeof(TensorFileHeader) && std::memcmp(header->magic, TensorFileMagic, sizeof(TensorFileMagic)) == 0) {
+        if (header->rows != rows || header->cols != cols) {
+            errs << "Error: " << path << " holds a <" << header->rows << "," << header->cols
+                 << "> tensor but <" << rows << "," << cols << "> was requested" << std::endl;
+            return Tensor();
+        }
+        if (header->elementType != uint64_t(ElementType::F64) && header->elementType != uint64_t(ElementType::F32)) {
+            errs << "Error: " << path << " has unknown element type " << header->elementType << std::endl;
+            return Tensor();
+        }
+        type = ElementType(header->elementType);
+        offset = sizeof(TensorFileHeader);
+    }
+    // Cannot overflow: bounded by maxDataSize.
+    size_t dataSize = rows * cols * elementSize(type);
+    if (fileSize - offset != dataSize) {
+        errs << "Error: " << path << " has " << fileSize - offset << " bytes of data but <" << rows << ","
+             << cols << "> needs " << dataSize << std::endl;
+        return Tensor();
+    }
+    ::madvise(base, fileSize, MADV_SEQUENTIAL);
+
+    Tensor t;
+    t.Rows = rows;
+    t.Cols = cols;
+    t.Type = type;
+    t.Data = static_cast<const char *>(base) + offset;
+    t.Storage = std::move(storage);
+    return t;
+}
+
+bool Tensor::store(const std::string &path, std::ostream &errs) const {
+    if (!isLittleEndian()) {
+        errs << "Error: store is only supported on little-endian hosts" << std::endl;
+        return false;
+    }
+    // Write a temporary file next to `path` and rename it over the target:
+    // tensors loaded from `path`, possibly this one, keep mapping the old file.
+    std::string tmpPath = path + ".XXXXXX";
+    int fd = ::mkstemp(&tmpPath[0]);
+    if (fd < 0) {
+        errs << "Error opening file: " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    TensorFileHeader header{};
+    std::memcpy(header.magic, TensorFileMagic, sizeof(TensorFileMagic));
+    header.rows = Rows;
+    header.cols = Cols;
+    header.elementType = uint64_t(Type);
+    bool ok = ::fchmod(fd, 0644) == 0 && writeAll(fd, reinterpret_cast<const char *>(&header), sizeof(header)) &&
+              writeAll(fd, static_cast<const char *>(Data), sizeInBytes());
+    if (!ok) {
+        errs << "Error: cannot write " << path << ": " << std::strerror(errno) << std::endl;
+    }
+    if (::close(fd) < 0 && ok) {
+        errs << "Error: cannot write " << path << ": " << std::strerror(errno) << std::endl;
+        ok = false;
+    }
+    if (ok && ::rename(tmpPath.c_str(), path.c_str()) < 0) {
+        errs << "Error: cannot replace " << path << ": " << std::strerror(errno) << std::endl;
+        ok = false;
+    }
+    if (!ok) {
+        ::unlink(tmpPath.c_str());
+    }
+    return ok;
+}
+
+Tensor Tensor::reshape(size_t rows, size_t cols) const {
+    Tensor t = *this;
+    t.Rows = rows;
+    t.Cols = cols;
+    return t;
+}
+
+Tensor Tensor::convert(ElementType type) const {
+    if (type == Type) {
+        return *this;
+    }
+    Tensor res = create(Rows, Cols, type);
+    if (type == ElementType::F32) {
+        convertElements(data<double>(), res.mutableData<float>(), size());
+    } else {
+        convertElements(data<float>(), res.mutableData<double>(), size());
+    }
+    return res;
+}
+
+Tensor transpose(const Tensor &t) {
+    Tensor res = Tensor::create(t.cols(), t.rows(), t.elementType());
+    if (t.elementType() == ElementType::F32) {
+        transposeElements(t.data<float>(), res.mutableData<float>(), t.rows(), t.cols());
+    } else {
+        transposeElements(t.data<double>(), res.mutableData<double>(), t.rows(), t.cols());
+    }
+    return res;
+}
+
+Tensor elementwise(char op, const Tensor &lhs, const Tensor &rhs) {
+    Tensor res = Tensor::create(lhs.rows(), lhs.cols(), lhs.elementType());
+    if (lhs.elementType() == ElementType::F32) {
+        elementwiseElements(op, lhs.data<float>(), rhs.data<float>(), res.mutableData<float>(), lhs.size());
+    } else {
+        elementwiseElements(op, lhs.data<double>(), rhs.data<double>(), res.mutableData<double>(), lhs.size());
+    }
+    return res;
+}
+
+Tensor elementwiseScalar(char op, const Tensor &t, double scalar, bool scalarIsLHS) {
+    Tensor res = Tensor::create(t.rows(), t.cols(), t.elementType());
+    if (t.elementType() == ElementType::F32) {
+        elementwiseScalarElements(op, t.data<float>(), float(scalar), scalarIsLHS, res.mutableData<float>(), t.size());
+    } else {
+        elementwiseScalarElements(op, t.data<double>(), scalar, scalarIsLHS, res.mutableData<double>(), t.size());
+    }
+    return res;
+}
+
+} // namespace toy
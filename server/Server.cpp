@@ -0,0 +1,386 @@
+#include "toy/Server.hpp"
+#include "toy/ASTVisitor.hpp"
+#include "toy/Interpreter.hpp"
+#include "toy/Lexer.hpp"
+#include "toy/Parser.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace toy;
+
+namespace {
+
+// FNV-1a; the filename is part of the key since it is baked into every Location.
+uint64_t hashSource(const std::string &name, const std::string &buffer) {
+    uint64_t h = 14695981039346656037ULL;
+    auto mix = [&h](const std::string &s) {
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+    };
+    mix(name);
+    h ^= 0xff;
+    h *= 1099511628211ULL;
+    mix(buffer);
+    return h;
+}
+
+struct NodeCounter : ASTWalker<NodeCounter> {
+    size_t nodes = 0;
+
+    template <typename NodeT>
+    WalkResult enter(NodeT *) {
+        nodes++;
+        return WalkResult::Advance;
+    }
+};
+
+bool writeAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool readExact(int fd, std::string &out, size_t size) {
+    out.resize(size);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::read(fd, &out[done], size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+// Reads a '\n' terminated header line. Headers are tiny, so byte-at-a-time is
+// fine. Stops once the line is longer than `limit`, leaving it that long.
+bool readLine(int fd, std::string &line, size_t limit) {
+    line.clear();
+    char c;
+    while (line.size() <= limit) {
+        ssize_t n = ::read(fd, &c, 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        if (c == '\n') {
+            return true;
+        }
+        line += c;
+    }
+    return true;
+}
+
+bool sendFrame(int fd, const std::string &head, const std::string &body) {
+    std::string header = head + " " + std::to_string(body.size()) + "\n";
+    return writeAll(fd, header.data(), header.size()) && writeAll(fd, body.data(), body.size());
+}
+
+int connectTo(const std::string &socketPath) {
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: socket path too long: " << socketPath << std::endl;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, socketPath.c_str());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        int err = errno; // callers inspect the connect() error
+        ::close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+std::shared_ptr<Server::CacheEntry> Server::lookup(const std::string &name, const std::string &buffer) {
+    uint64_t key = hashSource(name, buffer);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end() && (*it->second)->name == name && (*it->second)->source == buffer) {
+            lru.splice(lru.begin(), lru, it->second);
+            return *it->second;
+        }
+    }
+
+    // Parse outside the lock so that cold requests do not serialize.
+    auto entry = std::make_shared<CacheEntry>();
+    entry->key = key;
+    entry->name = name;
+    entry->source = buffer;
+    std::ostringstream errs;
+    Lexer lexer(name, buffer);
+    Parser parser(lexer, errs);
+    entry->module = parser.parseModule();
+    entry->errors = errs.str();
+    NodeCounter counter;
+    if (entry->module) {
+        counter.walk(*entry->module);
+    }
+    size_t bytes = name.size() + buffer.size() + entry->errors.size() + counter.nodes * AstNodeBytes;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        // Another connection won the race (or the key collided); keep theirs.
+        auto &cached = *it->second;
+        if (cached->name == name && cached->source == buffer) {
+            lru.splice(lru.begin(), lru, it->second);
+            return cached;
+        }
+        cacheBytes -= cached->bytes;
+        lru.erase(it->second);
+        cache.erase(it);
+    }
+    lru.push_front(entry);
+    cache.emplace(key, lru.begin());
+    charge(*entry, bytes);
+    return entry;
+}
+
+void Server::charge(CacheEntry &entry, size_t bytes) {
+    auto it = cache.find(entry.key);
+    if (it == cache.end() || it->second->get() != &entry) {
+        return; // already evicted
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    entry.bytes += bytes;
+    cacheBytes += bytes;
+    while (cacheBytes > MaxCacheBytes && lru.size() > 1) {
+        cacheBytes -= lru.back()->bytes;
+        cache.erase(lru.back()->key);
+        lru.pop_back();
+    }
+}
+
+Response Server::handle(const std::string &op, const std::string &name, const std::string &buffer) {
+    if (op != "parse" && op != "dump" && op != "run") {
+        return {false, "Error: unknown request '" + op + "'\n"};
+    }
+    auto entry = lookup(name, buffer);
+    if (!entry->module) {
+        return {false, entry->errors};
+    }
+    if (op == "parse") {
+        return {true, ""};
+    }
+    if (op == "run") {
+        // Evaluation only reads the AST, so concurrent runs can share the entry.
+        std::ostringstream out, errs;
+        RunOptions options;
+        options.threads = requestThreads;
+        options.print.threads = requestThreads;
+        bool ok = Interpreter(*entry->module, out, errs, options).run();
+        return {ok, ok ? out.str() : out.str() + errs.str()};
+    }
+    bool dumped = false;
+    std::call_once(entry->dumpOnce, [&entry, &dumped]() {
+        std::ostringstream os;
+        dump(*entry->module, os);
+        entry->dumpText = os.str();
+        dumped = true;
+    });
+    if (dumped) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        charge(*entry, entry->dumpText.size());
+    }
+    return {true, entry->dumpText};
+}
+
+void Server::serveConnection(int fd) {
+    // Runs on a detached thread: anything thrown here would terminate the
+    // whole server, so a failing request only drops its own connection.
+    try {
+        std::string line;
+        while (readLine(fd, line, MaxHeaderSize)) {
+            if (line.size() > MaxHeaderSize) {
+                sendFrame(fd, "error", "Error: request header too long\n");
+                break;
+            }
+            std::istringstream header(line);
+            std::string op;
+            size_t nameSize = 0, bufferSize = 0;
+            if (!(header >> op >> nameSize >> bufferSize)) {
+                sendFrame(fd, "error", "Error: malformed request header\n");
+                break;
+            }
+            if (nameSize > MaxNameSize || bufferSize > MaxBufferSize) {
+                sendFrame(fd, "error", "Error: request too large\n");
+                break;
+            }
+            std::string name, buffer;
+            if (!readExact(fd, name, nameSize) || !readExact(fd, buffer, bufferSize)) {
+                break;
+            }
+            Response res = handle(op, name, buffer);
+            if (!sendFrame(fd, res.ok ? "ok" : "error", res.output)) {
+                break;
+            }
+        }
+    } catch (const std::exception &e) {
+        sendFrame(fd, "error", std::string("Error: ") + e.what() + "\n");
+    }
+    ::close(fd);
+}
+
+int Server::serve() {
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: socket path too long: " << socketPath << std::endl;
+        return 1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, socketPath.c_str());
+
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error: socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    // Remove a stale socket left behind by a previous server, but never a
+    // regular file or the socket of a server that is still running.
+    struct stat st;
+    if (::lstat(socketPath.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            std::cerr << "Error: " << socketPath << " exists and is not a socket" << std::endl;
+            ::close(listenFd);
+            return 1;
+        }
+        int probe = connectTo(socketPath);
+        if (probe >= 0 || errno != ECONNREFUSED) {
+            std::cerr << "Error: " << socketPath << " is in use" << std::endl;
+            if (probe >= 0) {
+                ::close(probe);
+            }
+            ::close(listenFd);
+            return 1;
+        }
+        ::unlink(socketPath.c_str());
+    }
+    if (::bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listenFd, SOMAXCONN) < 0) {
+        std::cerr << "Error: cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        ::close(listenFd);
+        return 1;
+    }
+
+    // std::thread cannot choose its stack size, so connections run on detached
+    // pthreads with ConnectionStackSize.
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, ConnectionStackSize);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    while (true) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error: accept: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        auto connection = new std::pair<Server *, int>(this, fd);
+        auto run = [](void *arg) -> void * {
+            std::unique_ptr<std::pair<Server *, int>> connection(static_cast<std::pair<Server *, int> *>(arg));
+            connection->first->serveConnection(connection->second);
+            return nullptr;
+        };
+        pthread_t thread;
+        int err = pthread_create(&thread, &attr, run, connection);
+        if (err != 0) {
+            std::cerr << "Error: cannot start connection thread: " << std::strerror(err) << std::endl;
+            delete connection;
+            ::close(fd);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    ::close(listenFd);
+    return 1;
+}
+
+namespace toy {
+
+int runClient(const std::string &socketPath, const std::string &op, const std::string &filename) {
+    std::string buffer;
+    if (filename == "-") {
+        buffer.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    } else {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            return 1;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    int fd = connectTo(socketPath);
+    if (fd < 0) {
+        std::cerr << "Error: cannot connect to " << socketPath << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::string header = op + " " + std::to_string(filename.size()) + " " + std::to_string(buffer.size()) + "\n";
+    if (!writeAll(fd, header.data(), header.size()) || !writeAll(fd, filename.data(), filename.size()) ||
+        !writeAll(fd, buffer.data(), buffer.size())) {
+        std::cerr << "Error: failed to send request" << std::endl;
+        ::close(fd);
+        return 1;
+    }
+
+    std::string line, output, status;
+    size_t size = 0;
+    bool received = readLine(fd, line, 64);
+    std::istringstream responseHeader(line);
+    received = received && (responseHeader >> status >> size) && readExact(fd, output, size);
+    ::close(fd);
+    if (!received) {
+        std::cerr << "Error: connection closed by server" << std::endl;
+        return 1;
+    }
+    if (status != "ok") {
+        std::cerr << output;
+        return 1;
+    }
+    std::cout << output;
+    return 0;
+}
+
+} // namespace toy
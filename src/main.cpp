@@ -1,19 +1,184 @@
 #include "toy/Lexer.hpp"
 #include "toy/Parser.hpp"
 #include "toy/AST.hpp"
+#include "toy/AOT.hpp"
+#include "toy/Interpreter.hpp"
+#include "toy/LazyParser.hpp"
+#include "toy/PassManager.hpp"
+#include "toy/Server.hpp"
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename>" << std::endl;
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+static void usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " [--lazy] [--verify] [--time-passes] <filename>" << std::endl;
+    std::cerr << "       " << argv0 << " --run [--lazy] [--verify] [--time-passes] [--f32] [--threads=<n>] [--print-binary] [--print-threads=<n>] <filename>" << std::endl;
+    std::cerr << "       " << argv0 << " --profile [run options] [--profile-top=<n>] [--profile-out=<file>] <filename>" << std::endl;
+    std::cerr << "       " << argv0 << " --aot [--f32] <filename> <output-prefix>" << std::endl;
+    std::cerr << "       " << argv0 << " --serve [--threads=<n>] <socket>" << std::endl;
+    std::cerr << "       " << argv0 << " --client <socket> <parse|dump|run> <filename|->" << std::endl;
+}
+
+// toy --aot [--f32] <filename> <output-prefix> writes <output-prefix>.cpp and
+// <output-prefix>.h.
+static int compileAOT(int argc, char *argv[]) {
+    int arg = 2;
+    toy::ElementType defaultType = toy::ElementType::F64;
+    if (arg < argc && std::string(argv[arg]) == "--f32") {
+        defaultType = toy::ElementType::F32;
+        arg++;
+    }
+    if (argc - arg != 2) {
+        usage(argv[0]);
         return 1;
     }
+    std::string filename = argv[arg];
+    std::string prefix = argv[arg + 1];
+    std::string headerName = prefix.substr(prefix.find_last_of('/') + 1) + ".h";
 
-    toy::Lexer lexer(argv[1]);
+    toy::Lexer lexer(filename);
     toy::Parser parser(lexer);
     auto module = parser.parseModule();
-    toy::dump(*module);
     if (!module) {
         return 1;
     }
+    std::ostringstream source, header;
+    if (!toy::emitAOT(*module, filename, defaultType, source, header, headerName, std::cerr)) {
+        return 1;
+    }
+    std::ofstream sourceFile(prefix + ".cpp"), headerFile(prefix + ".h");
+    sourceFile << source.str();
+    headerFile << header.str();
+    if (!sourceFile || !headerFile) {
+        std::cerr << "Error: cannot write " << prefix << ".cpp/.h" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    if (mode == "--serve") {
+        // Threads per run request; requests themselves run concurrently.
+        unsigned requestThreads = 1;
+        if (argc == 4 && std::string(argv[2]).rfind("--threads=", 0) == 0) {
+            requestThreads = std::strtoul(argv[2] + strlen("--threads="), nullptr, 10);
+        } else if (argc != 3) {
+            usage(argv[0]);
+            return 1;
+        }
+        return toy::Server(argv[argc - 1], requestThreads).serve();
+    }
+    if (mode == "--client") {
+        if (argc != 5) {
+            usage(argv[0]);
+            return 1;
+        }
+        return toy::runClient(argv[2], argv[3], argv[4]);
+    }
+
+    if (mode == "--aot") {
+        return compileAOT(argc, argv);
+    }
+
+    // --profile runs like --run, then reports where time and memory went.
+    bool profile = mode == "--profile";
+    bool run = mode == "--run" || profile;
+    bool lazy = false;
+    bool verify = false;
+    bool timePasses = false;
+    int fileArg = run ? 2 : 1;
+    toy::RunOptions runOptions;
+    size_t profileTop = 20;
+    std::string profileOut;
+    for (; fileArg < argc - 1; fileArg++) {
+        std::string opt = argv[fileArg];
+        if (opt == "--lazy") {
+            lazy = true;
+        } else if (opt == "--verify") {
+            verify = true;
+        } else if (opt == "--time-passes") {
+            timePasses = true;
+        } else if (!run) {
+            usage(argv[0]);
+            return 1;
+        } else if (opt == "--f32") {
+            runOptions.defaultType = toy::ElementType::F32;
+        } else if (opt == "--print-binary") {
+            runOptions.print.binary = true;
+        } else if (opt.rfind("--threads=", 0) == 0) {
+            runOptions.threads = std::strtoul(opt.c_str() + strlen("--threads="), nullptr, 10);
+        } else if (opt.rfind("--print-threads=", 0) == 0) {
+            runOptions.print.threads = std::strtoul(opt.c_str() + strlen("--print-threads="), nullptr, 10);
+        } else if (profile && opt.rfind("--profile-top=", 0) == 0) {
+            profileTop = std::strtoul(opt.c_str() + strlen("--profile-top="), nullptr, 10);
+        } else if (profile && opt.rfind("--profile-out=", 0) == 0) {
+            profileOut = opt.substr(strlen("--profile-out="));
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (fileArg != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<toy::ModuleAST> module;
+    if (lazy) {
+        // Parse only what main can reach; with --verify, list the rest.
+        std::vector<std::unique_ptr<toy::PrototypeExprAST>> unreachable;
+        module = toy::parseReachable(argv[fileArg], std::cerr, verify ? &unreachable : nullptr);
+        for (auto &proto : unreachable) {
+            std::cerr << "Note: function '" << proto->getName() << "' is unreachable from main at line "
+                      << proto->loc().Line << " column " << proto->loc().Column << std::endl;
+        }
+    } else {
+        toy::Lexer lexer(argv[fileArg]);
+        toy::Parser parser(lexer);
+        module = parser.parseModule();
+    }
+    if (!module) {
+        return 1;
+    }
+    toy::PassManager pm;
+    pm.enableTiming(timePasses);
+    if (verify) {
+        pm.addPass(toy::createVerifierPass(std::cerr));
+    }
+    bool ok = pm.run(*module);
+    if (timePasses) {
+        pm.printTimings(std::cerr);
+    }
+    if (!ok) {
+        return 1;
+    }
+    if (profile) {
+        toy::Profiler profiler;
+        runOptions.profiler = &profiler;
+        bool ok = toy::Interpreter(*module, std::cout, std::cerr, runOptions).run();
+        profiler.report(std::cerr, profileTop);
+        if (!profileOut.empty()) {
+            std::ofstream collapsed(profileOut);
+            profiler.writeCollapsed(collapsed);
+            if (!collapsed) {
+                std::cerr << "Error: cannot write " << profileOut << std::endl;
+                return 1;
+            }
+        }
+        return ok ? 0 : 1;
+    }
+    if (run) {
+        return toy::Interpreter(*module, std::cout, std::cerr, runOptions).run() ? 0 : 1;
+    }
+    toy::dump(*module);
     return 0;
-}
\ No newline at end of file
+}